@@ -0,0 +1,75 @@
+/*
+ * Generates the ALMANAC resource (format in src/almanac.h) for the
+ * location in src/config.h, in the standard time of its ZONE, using the
+ * same sunmooncalc/moon_phase code the watch would run.
+ *
+ *   ./almanac_gen out.bin first_year years
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "almanac.h"
+#include "config.h"
+#include "sunmoon.h"
+#include "tz.h"
+
+static void put16(FILE *f, int v)
+{
+    fputc(v & 0xff, f);
+    fputc((v >> 8) & 0xff, f);
+}
+
+static void put32(FILE *f, long v)
+{
+    put16(f, v & 0xffff);
+    put16(f, (v >> 16) & 0xffff);
+}
+
+static int minutes(float hours)
+{
+    return (hours == 99.0) ? ALMANAC_NONE : (int)(hours * 60.0 + 0.5);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *f;
+    int first, last, jd, year, years;
+    float sr, ss, mr, ms, tz = tz_zones[ZONE].offset / 60.0;
+
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s out.bin first_year years\n", argv[0]);
+        return 2;
+    }
+    year = atoi(argv[2]);
+    years = atoi(argv[3]);
+    first = jdn(year, 1, 1);
+    last = jdn(year + years, 1, 1);
+    if (!(f = fopen(argv[1], "wb"))) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fwrite(ALMANAC_MAGIC, 1, 4, f);
+    put32(f, first);
+    put16(f, last - first);
+    put16(f, ALMANAC_CENTI(LAT));
+    put16(f, ALMANAC_CENTI(LON));
+    put16(f, ALMANAC_CENTI(tz));
+
+    for (jd = first; jd < last; jd++) {
+        int phase = (int)(moon_phase(jd) * 27 + 0.5);
+        sunmooncalc(jd, tz, LAT, -LON, 1, &sr, &ss);
+        sunmooncalc(jd, tz, LAT, -LON, 0, &mr, &ms);
+        put16(f, minutes(sr) | (phase << ALMANAC_PHASE_SHIFT));
+        put16(f, minutes(ss));
+        put16(f, minutes(mr));
+        put16(f, minutes(ms));
+    }
+
+    if (fclose(f) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    printf("%s: %d days from %d, %d bytes\n", argv[1], last - first, year,
+           ALMANAC_HEADER_SIZE + (last - first) * ALMANAC_RECORD_SIZE);
+    return 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * Packs the weather icons and the battery/bluetooth status glyphs into
+ * the ICON_ATLAS image (layout in src/atlas.h).  The icons are read from
+ * resources/images in phone index order; the status glyphs are drawn
+ * here from the pixel maps below.
+ *
+ *   ./atlas_pack images_dir out.png
+ *
+ * Only 8-bit RGBA, non-interlaced PNGs are read, which is what the
+ * icons are.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "atlas.h"
+
+/* in the order of WEATHER_ICONS on the phone side */
+static const char *const icon_files[ATLAS_ICONS] = {
+    "chanceflurries", "chancesnow", "chancetstorms", "cloudy", "flurries",
+    "nt_chanceflurries", "nt_chancesnow", "nt_partlycloudy", "nt_sunny",
+    "partlycloudy", "rain", "snow", "sunny", "unknown", "fog",
+};
+
+/* '#' = opaque black, anything else transparent */
+static const char *const status_glyphs[ATLAS_STATUS_COUNT][ATLAS_STATUS_H] = {
+    [ATLAS_BATT_000_020] = {
+        "############### ",
+        "#             # ",
+        "# ##          ##",
+        "# ##          ##",
+        "# ##          ##",
+        "# ##          ##",
+        "# ##          ##",
+        "#             # ",
+        "############### ",
+    },
+    [ATLAS_BATT_020_040] = {
+        "############### ",
+        "#             # ",
+        "# ####        ##",
+        "# ####        ##",
+        "# ####        ##",
+        "# ####        ##",
+        "# ####        ##",
+        "#             # ",
+        "############### ",
+    },
+    [ATLAS_BATT_040_060] = {
+        "############### ",
+        "#             # ",
+        "# ######      ##",
+        "# ######      ##",
+        "# ######      ##",
+        "# ######      ##",
+        "# ######      ##",
+        "#             # ",
+        "############### ",
+    },
+    [ATLAS_BATT_060_080] = {
+        "############### ",
+        "#             # ",
+        "# ########    ##",
+        "# ########    ##",
+        "# ########    ##",
+        "# ########    ##",
+        "# ########    ##",
+        "#             # ",
+        "############### ",
+    },
+    [ATLAS_BATT_080_100] = {
+        "############### ",
+        "#             # ",
+        "# ########### ##",
+        "# ########### ##",
+        "# ########### ##",
+        "# ########### ##",
+        "# ########### ##",
+        "#             # ",
+        "############### ",
+    },
+    [ATLAS_BATT_CHARGING] = {
+        "############### ",
+        "#      #      # ",
+        "#     ##      ##",
+        "#    ###      ##",
+        "#   #######   ##",
+        "#      ###    ##",
+        "#      ##     ##",
+        "#      #      # ",
+        "############### ",
+    },
+    [ATLAS_BT_ON] = {
+        "       #         ",
+        "       ##        ",
+        "     # # #       ",
+        "      ###        ",
+        "       #         ",
+        "      ###        ",
+        "     # # #       ",
+        "       ##        ",
+        "       #         ",
+    },
+    [ATLAS_BT_OFF] = {
+        "  #    #    #    ",
+        "   #   ##  #     ",
+        "    ## # ##      ",
+        "     ####        ",
+        "      ##         ",
+        "     ####        ",
+        "    ## # ##      ",
+        "   #   ## #      ",
+        "  #    #   #     ",
+    },
+};
+
+static unsigned char atlas[ATLAS_HEIGHT][ATLAS_WIDTH][4];
+
+static unsigned long be32(const unsigned char *p)
+{
+    return (unsigned long)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static int paeth(int a, int b, int c)
+{
+    int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+}
+
+/* decode an RGBA8 PNG into atlas at (x0, y0); returns 0 on success */
+static int read_icon(const char *path, int x0, int y0)
+{
+    FILE *f = fopen(path, "rb");
+    unsigned char *file, *idat = NULL, *raw, *zero, *prev, *line;
+    unsigned long w = 0, h = 0, nidat = 0, pos = 8;
+    uLongf nraw;
+    long size;
+    unsigned x, y;
+
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+    file = malloc(size);
+    if (fread(file, 1, size, f) != (size_t)size) size = 0;
+    fclose(f);
+
+    while (pos + 12 <= (unsigned long)size) {
+        unsigned long n = be32(file + pos);
+        const unsigned char *type = file + pos + 4, *data = file + pos + 8;
+        if (!memcmp(type, "IHDR", 4)) {
+            w = be32(data);
+            h = be32(data + 4);
+            if (data[8] != 8 || data[9] != 6 || data[12] != 0) {
+                fprintf(stderr, "%s: not a non-interlaced RGBA8 PNG\n", path);
+                free(file);
+                return -1;
+            }
+        } else if (!memcmp(type, "IDAT", 4)) {
+            idat = realloc(idat, nidat + n);
+            memcpy(idat + nidat, data, n);
+            nidat += n;
+        }
+        pos += 12 + n;
+    }
+    free(file);
+    if (w != ATLAS_ICON_SIZE || h != ATLAS_ICON_SIZE) {
+        fprintf(stderr, "%s: %lux%lu, expected %dx%d\n", path, w, h, ATLAS_ICON_SIZE, ATLAS_ICON_SIZE);
+        free(idat);
+        return -1;
+    }
+
+    nraw = h * (1 + w * 4);
+    raw = malloc(nraw);
+    if (uncompress(raw, &nraw, idat, nidat) != Z_OK) {
+        fprintf(stderr, "%s: bad image data\n", path);
+        free(idat);
+        free(raw);
+        return -1;
+    }
+    free(idat);
+
+    prev = zero = calloc(w * 4, 1);
+    for (y = 0; y < h; y++) {
+        int filter = raw[y * (1 + w * 4)];
+        line = raw + y * (1 + w * 4) + 1;
+        for (x = 0; x < w * 4; x++) {
+            int a = x >= 4 ? line[x - 4] : 0, b = prev[x], c = x >= 4 ? prev[x - 4] : 0;
+            switch (filter) {
+            case 1: line[x] += a; break;
+            case 2: line[x] += b; break;
+            case 3: line[x] += (a + b) / 2; break;
+            case 4: line[x] += paeth(a, b, c); break;
+            }
+        }
+        memcpy(atlas[y0 + y][x0], line, w * 4);
+        prev = line;
+    }
+    free(zero);
+    free(raw);
+    return 0;
+}
+
+static void draw_glyph(int g)
+{
+    int x, y;
+    for (y = 0; y < ATLAS_STATUS_H; y++)
+        for (x = 0; x < ATLAS_STATUS_W && status_glyphs[g][y][x]; x++)
+            if (status_glyphs[g][y][x] == '#') {
+                unsigned char *p = atlas[ATLAS_STATUS_Y + y][g * ATLAS_STATUS_W + x];
+                p[0] = p[1] = p[2] = 0;
+                p[3] = 255;
+            }
+}
+
+static void put32(unsigned char *p, unsigned long v)
+{
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static void write_chunk(FILE *f, const char *type, const unsigned char *data, unsigned long n)
+{
+    unsigned char b[4];
+    uLong crc = crc32(crc32(0, (const Bytef *)type, 4), data, n);
+    put32(b, n);
+    fwrite(b, 1, 4, f);
+    fwrite(type, 1, 4, f);
+    fwrite(data, 1, n, f);
+    put32(b, crc);
+    fwrite(b, 1, 4, f);
+}
+
+static int write_png(const char *path)
+{
+    static unsigned char raw[ATLAS_HEIGHT * (1 + ATLAS_WIDTH * 4)];
+    unsigned char ihdr[13] = { 0 }, *z;
+    uLongf nz = compressBound(sizeof(raw));
+    FILE *f;
+    int y;
+
+    for (y = 0; y < ATLAS_HEIGHT; y++) {
+        raw[y * (1 + ATLAS_WIDTH * 4)] = 0;
+        memcpy(raw + y * (1 + ATLAS_WIDTH * 4) + 1, atlas[y], ATLAS_WIDTH * 4);
+    }
+    z = malloc(nz);
+    compress2(z, &nz, raw, sizeof(raw), 9);
+
+    f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        free(z);
+        return -1;
+    }
+    put32(ihdr, ATLAS_WIDTH);
+    put32(ihdr + 4, ATLAS_HEIGHT);
+    ihdr[8] = 8;    /* bit depth */
+    ihdr[9] = 6;    /* RGBA */
+    fwrite("\211PNG\r\n\032\n", 1, 8, f);
+    write_chunk(f, "IHDR", ihdr, 13);
+    write_chunk(f, "IDAT", z, nz);
+    write_chunk(f, "IEND", NULL, 0);
+    fclose(f);
+    free(z);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    char path[1024];
+    unsigned char *px = &atlas[0][0][0];
+    int i;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s images_dir out.png\n", argv[0]);
+        return 2;
+    }
+
+    /* transparent white, like the icons' background */
+    memset(atlas, 0xff, sizeof(atlas));
+    for (i = 0; i < ATLAS_HEIGHT * ATLAS_WIDTH; i++) px[i * 4 + 3] = 0;
+
+    for (i = 0; i < ATLAS_ICONS; i++) {
+        snprintf(path, sizeof(path), "%s/%s.png", argv[1], icon_files[i]);
+        if (read_icon(path, (i % ATLAS_COLUMNS) * ATLAS_ICON_SIZE, (i / ATLAS_COLUMNS) * ATLAS_ICON_SIZE))
+            return 1;
+    }
+    for (i = 0; i < ATLAS_STATUS_COUNT; i++) draw_glyph(i);
+
+    if (write_png(argv[2])) return 1;
+    printf("%s: %dx%d, %d icons, %d status glyphs; ~%d bytes as a 1-bit bitmap\n",
+           argv[2], ATLAS_WIDTH, ATLAS_HEIGHT, ATLAS_ICONS, ATLAS_STATUS_COUNT,
+           (ATLAS_WIDTH + 31) / 32 * 4 * ATLAS_HEIGHT);
+    return 0;
+}
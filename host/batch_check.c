@@ -0,0 +1,103 @@
+/*
+ * sunmoon_batch (sunmoon_batch.h) against sunmooncalc: every kernel
+ * the CPU runs over a set of places and days, with the results compared
+ * bit for bit and the throughput in places per second.
+ *
+ *   ./batch_check [-n places] [-d days]      default 4096 places, 24 days
+ *
+ * Places are spread evenly in sin(latitude) between 85S and 85N, with
+ * random longitudes and zones of longitude/15 rounded to whole hours.
+ * Days are spread over 2026.  A place's result must be identical to
+ * sunmooncalc's, both events; exits 1 if any is not.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "sunmoon.h"
+#include "sunmoon_batch.h"
+
+#define NOBJ 3
+
+static const char *OBJ_NAME[NOBJ] = { "moon", "sun", "twilight" };
+
+int main(int argc, char **argv)
+{
+    int n = 4096, days = 24, i, d, obj, isa, failed = 0;
+    int first = jdn(2026, 1, 1);
+    float *tz, *lat, *lon, *rise, *set, *want_rise, *want_set;
+    double scalar_s[NOBJ] = { 0 };
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) n = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc) days = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [-n places] [-d days]\n", argv[0]);
+            return 2;
+        }
+    }
+    tz = malloc(n * sizeof(float));
+    lat = malloc(n * sizeof(float));
+    lon = malloc(n * sizeof(float));
+    rise = malloc(n * sizeof(float));
+    set = malloc(n * sizeof(float));
+    want_rise = malloc((size_t)n * days * NOBJ * sizeof(float));
+    want_set = malloc((size_t)n * days * NOBJ * sizeof(float));
+    srand(1);
+    for (i = 0; i < n; i++) {
+        lat[i] = asin(sin(85 * M_PI / 180) * (2.0 * (i + 0.5) / n - 1)) * 180 / M_PI;
+        lon[i] = 360.0 * rand() / ((double)RAND_MAX + 1) - 180;
+        tz[i] = floorf(-lon[i] / 15 + 0.5f);
+    }
+
+    /* what sunmooncalc says, timed as the baseline */
+    for (obj = 0; obj < NOBJ; obj++) {
+        double t0 = bench_now_ns();
+        for (d = 0; d < days; d++) {
+            float *r = want_rise + ((size_t)obj * days + d) * n, *s = want_set + ((size_t)obj * days + d) * n;
+            for (i = 0; i < n; i++)
+                sunmooncalc(first + d * 365 / days, tz[i], lat[i], lon[i], obj, &r[i], &s[i]);
+        }
+        scalar_s[obj] = (bench_now_ns() - t0) / 1e9;
+    }
+
+    printf("%d places x %d days of 2026\n\n%-8s %-9s %10s %10s %14s %8s\n", n, days, "kernel", "object",
+           "events", "differ", "places/s", "speedup");
+    for (isa = 0; isa < BATCH_ISAS; isa++) {
+        for (obj = 0; obj < NOBJ; obj++) {
+            long events = 0, differ = 0;
+            double t0, secs = 0;
+            for (d = 0; d < days; d++) {
+                const float *r = want_rise + ((size_t)obj * days + d) * n;
+                const float *s = want_set + ((size_t)obj * days + d) * n;
+                t0 = bench_now_ns();
+                if (!sunmoon_batch_isa(isa, first + d * 365 / days, obj, n, tz, lat, lon, rise, set))
+                    break;
+                secs += (bench_now_ns() - t0) / 1e9;
+                for (i = 0; i < n; i++) {
+                    events += (r[i] != 99.0) + (s[i] != 99.0);
+                    differ += memcmp(&rise[i], &r[i], sizeof(float)) != 0;
+                    differ += memcmp(&set[i], &s[i], sizeof(float)) != 0;
+                }
+            }
+            if (d < days) {
+                printf("%-8s (not available on this CPU or build)\n", sunmoon_batch_name(isa));
+                break;
+            }
+            printf("%-8s %-9s %10ld %10ld %14.0f %7.2fx\n", sunmoon_batch_name(isa), OBJ_NAME[obj],
+                   events, differ, (double)n * days / secs, scalar_s[obj] / secs);
+            if (differ) failed = 1;
+        }
+    }
+    printf("\n(sunmooncalc itself: %.0f sun places/s; \"differ\" counts results not bit-identical to it)\n",
+           (double)n * days / scalar_s[1]);
+    free(tz);
+    free(lat);
+    free(lon);
+    free(rise);
+    free(set);
+    free(want_rise);
+    free(want_set);
+    return failed;
+}
@@ -0,0 +1,331 @@
+/*
+ * Microbenchmarks for the pure-C modules of the watchface, built for
+ * the host.  Numbers are only meaningful relative to each other and to
+ * a previous run on the same machine (use -o / -b to save and compare).
+ *
+ *   ./bench [-r rounds] [-o save.txt] [-b baseline.txt] [filter]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+#include "pbl-math.h"
+#include "sunmoon.h"
+#include "mini-printf.h"
+#include "util.h"
+#include "timefmt.h"
+
+#define NINPUT 1024
+#define JD_2014 2456659     /* 2014-01-01 */
+
+static float in_angle[NINPUT];  /* [-2pi, 2pi] */
+static float in_unit[NINPUT];   /* [-1, 1] */
+static float in_pos[NINPUT];    /* [0, 1000] */
+static float in_atan[NINPUT];   /* [-20, 20] */
+
+static void init_inputs(void)
+{
+    int i;
+    srand(12345);
+    for (i = 0; i < NINPUT; i++) {
+        float u = rand() / (float)RAND_MAX;
+        in_angle[i] = (u * 4 - 2) * M_PI;
+        in_unit[i] = u * 2 - 1;
+        in_pos[i] = u * 1000;
+        in_atan[i] = u * 40 - 20;
+    }
+}
+
+static double b_sqrt(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) s += pbl_sqrt(in_pos[i & (NINPUT-1)]);
+    return s;
+}
+
+static double b_sin(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) s += pbl_sin(in_angle[i & (NINPUT-1)]);
+    return s;
+}
+
+static double b_cos(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) s += pbl_cos(in_angle[i & (NINPUT-1)]);
+    return s;
+}
+
+static double b_atan(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) s += pbl_atan(in_atan[i & (NINPUT-1)]);
+    return s;
+}
+
+static double b_acos(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) s += pbl_acos(in_unit[i & (NINPUT-1)]);
+    return s;
+}
+
+static double b_sunmoon(long n, int iobj)
+{
+    double s = 0;
+    float rise, set;
+    long i;
+    for (i = 0; i < n; i++) {
+        sunmooncalc(JD_2014 + (i % 366), -5.0, 33.9616, 83.4299, iobj, &rise, &set);
+        s += rise + set;
+    }
+    return s;
+}
+
+static double b_sun(long n)  { return b_sunmoon(n, 1); }
+static double b_moon(long n) { return b_sunmoon(n, 0); }
+
+/* one call per new day, as handle_sunmoon does at midnight */
+static double b_riseset_day(long n, int iobj)
+{
+    RiseSet rs = { 0 };
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        riseset_update(&rs, JD_2014 + i % 3650, -5.0, 33.9616, 83.4299, iobj);
+        s += rs.rise + rs.set;
+    }
+    return s;
+}
+
+static double b_riseset_sun(long n)  { return b_riseset_day(n, 1); }
+static double b_riseset_moon(long n) { return b_riseset_day(n, 0); }
+
+/* same day again: the cache hit */
+static double b_riseset_hit(long n)
+{
+    RiseSet rs = { 0 };
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        riseset_update(&rs, JD_2014, -5.0, 33.9616, 83.4299, 0);
+        s += rs.rise;
+    }
+    return s;
+}
+
+static double b_snprintf_time(long n)
+{
+    char buf[8];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        mini_snprintf(buf, sizeof(buf), "%d:%02d", (int)(i % 24), (int)(i % 60));
+        s += buf[0];
+    }
+    return s;
+}
+
+static double b_snprintf_str(long n)
+{
+    char buf[8];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        mini_snprintf(buf, sizeof(buf), "%s", (i & 1) ? "6:42" : "18:07");
+        s += buf[1];
+    }
+    return s;
+}
+
+static double b_snprintf_fixed(long n)
+{
+    char buf[12];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        mini_snprintf(buf, sizeof(buf), "%.1f", (double)(i % 2000 - 1000) * 0.037f);
+        s += buf[1];
+    }
+    return s;
+}
+
+/* the C library's snprintf, for comparison */
+static double b_libc_time(long n)
+{
+    char buf[8];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "%d:%02d", (int)(i % 24), (int)(i % 60));
+        s += buf[0];
+    }
+    return s;
+}
+
+static double b_libc_fixed(long n)
+{
+    char buf[12];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "%.1f", (double)(i % 2000 - 1000) * 0.037f);
+        s += buf[1];
+    }
+    return s;
+}
+
+static double b_itoa(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) s += itoa((int)(i % 1999) - 999)[0];
+    return s;
+}
+
+/* one tm per minute of 2014, as handle_tick sees them */
+#define NTM 1024
+static struct tm in_tm[NTM];
+
+static void init_tm(void)
+{
+    time_t t = 1388534400;      /* 2014-01-01 00:00 UTC */
+    int i;
+    for (i = 0; i < NTM; i++, t += 6427)
+        gmtime_r(&t, &in_tm[i]);
+}
+
+static double b_strftime_time(long n)
+{
+    char buf[6];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        strftime(buf, sizeof(buf), "%I:%M", &in_tm[i & (NTM-1)]);
+        if (buf[0] == '0') memmove(buf, buf + 1, sizeof(buf) - 1);
+        s += buf[0];
+    }
+    return s;
+}
+
+static double b_timefmt_time(long n)
+{
+    char buf[6];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        timefmt_time(buf, &in_tm[i & (NTM-1)]);
+        s += buf[0];
+    }
+    return s;
+}
+
+static double b_strftime_secs(long n)
+{
+    char buf[3];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        strftime(buf, sizeof(buf), "%S", &in_tm[i & (NTM-1)]);
+        s += buf[1];
+    }
+    return s;
+}
+
+static double b_timefmt_secs(long n)
+{
+    char buf[3];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        timefmt_seconds(buf, &in_tm[i & (NTM-1)]);
+        s += buf[1];
+    }
+    return s;
+}
+
+static double b_strftime_date(long n)
+{
+    char day[10], date[7];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        strftime(day, sizeof(day), "%A", &in_tm[i & (NTM-1)]);
+        strftime(date, sizeof(date), "%b %e", &in_tm[i & (NTM-1)]);
+        s += day[0] + date[5];
+    }
+    return s;
+}
+
+static double b_timefmt_date(long n)
+{
+    char day[10], date[7];
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        timefmt_day(day, &in_tm[i & (NTM-1)]);
+        timefmt_date(date, &in_tm[i & (NTM-1)]);
+        s += day[0] + date[5];
+    }
+    return s;
+}
+
+static const BenchCase cases[] = {
+    { "pbl_sqrt",                b_sqrt,            200000 },
+    { "pbl_sin",                 b_sin,            1000000 },
+    { "pbl_cos",                 b_cos,            1000000 },
+    { "pbl_atan",                b_atan,           1000000 },
+    { "pbl_acos",                b_acos,           1000000 },
+    { "sunmooncalc_sun",         b_sun,              20000 },
+    { "sunmooncalc_moon",        b_moon,             10000 },
+    { "riseset_update_sun_day",  b_riseset_sun,      20000 },
+    { "riseset_update_moon_day", b_riseset_moon,     20000 },
+    { "riseset_update_hit",      b_riseset_hit,    1000000 },
+    { "mini_snprintf_%d:%02d",   b_snprintf_time,   500000 },
+    { "mini_snprintf_%s",        b_snprintf_str,    500000 },
+    { "mini_snprintf_%.1f",      b_snprintf_fixed,  500000 },
+    { "snprintf_%d:%02d",        b_libc_time,       500000 },
+    { "snprintf_%.1f",           b_libc_fixed,      500000 },
+    { "itoa",                    b_itoa,           1000000 },
+    { "strftime_%I:%M",          b_strftime_time,  1000000 },
+    { "timefmt_time",            b_timefmt_time,   1000000 },
+    { "strftime_%S",             b_strftime_secs,  1000000 },
+    { "timefmt_seconds",         b_timefmt_secs,   1000000 },
+    { "strftime_%A_%b_%e",       b_strftime_date,  1000000 },
+    { "timefmt_day_date",        b_timefmt_date,   1000000 },
+};
+
+#define NCASES (int)(sizeof(cases) / sizeof(cases[0]))
+
+int main(int argc, char **argv)
+{
+    BenchCase sel[NCASES];
+    const char *save = NULL, *baseline = NULL, *filter = NULL;
+    int rounds = 10, nsel = 0, i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc) rounds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) save = argv[++i];
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) baseline = argv[++i];
+        else if (argv[i][0] != '-') filter = argv[i];
+        else {
+            fprintf(stderr, "usage: %s [-r rounds] [-o save] [-b baseline] [filter]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    for (i = 0; i < NCASES; i++)
+        if (!filter || strstr(cases[i].name, filter))
+            sel[nsel++] = cases[i];
+
+    init_inputs();
+    init_tm();
+    return bench_main(sel, nsel, rounds, save, baseline);
+}
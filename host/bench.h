@@ -0,0 +1,41 @@
+/*
+ * Tiny timing harness for the host-native builds of the watch modules.
+ *
+ * A benchmark case is a function that runs its kernel `iters` times and
+ * returns something derived from the results, so the optimiser cannot
+ * throw the work away.  bench_run() times the case over several rounds
+ * and reports mean ns/call, calls/sec and the spread between rounds.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+typedef double (*bench_fn)(long iters);
+
+typedef struct {
+    const char *name;
+    bench_fn    fn;
+    long        iters;      /* calls per round */
+} BenchCase;
+
+typedef struct {
+    double ns_per_call;     /* mean over rounds */
+    double stddev;          /* ns, between rounds */
+    double calls_per_sec;
+} BenchResult;
+
+/* monotonic clock in ns */
+double bench_now_ns(void);
+
+BenchResult bench_run(const BenchCase *c, int rounds);
+
+/*
+ * Run every case, print a table and optionally save/compare results.
+ * save/baseline are file names or NULL.
+ */
+int bench_main(const BenchCase *cases, int ncases, int rounds,
+               const char *save, const char *baseline);
+
+/* keeps values alive across the timed loop */
+extern volatile double bench_sink;
+
+#endif // BENCH_H
@@ -0,0 +1,106 @@
+/*
+ * Timing harness, see bench.h
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+
+#define MAX_ROUNDS 64
+
+volatile double bench_sink;
+
+double bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+BenchResult bench_run(const BenchCase *c, int rounds)
+{
+    BenchResult r;
+    double ns[MAX_ROUNDS];
+    double sum = 0, var = 0;
+    int i;
+
+    if (rounds > MAX_ROUNDS) rounds = MAX_ROUNDS;
+    if (rounds < 1) rounds = 1;
+
+    /* warm caches and branch predictors */
+    bench_sink += c->fn(c->iters / 10 + 1);
+
+    for (i = 0; i < rounds; i++) {
+        double t0 = bench_now_ns();
+        bench_sink += c->fn(c->iters);
+        ns[i] = (bench_now_ns() - t0) / c->iters;
+        sum += ns[i];
+    }
+    r.ns_per_call = sum / rounds;
+    for (i = 0; i < rounds; i++)
+        var += (ns[i] - r.ns_per_call) * (ns[i] - r.ns_per_call);
+    r.stddev = (rounds > 1) ? sqrt(var / (rounds - 1)) : 0;
+    r.calls_per_sec = 1e9 / r.ns_per_call;
+    return r;
+}
+
+/* look up a previous ns/call for name in a saved result file */
+static int baseline_lookup(FILE *f, const char *name, double *ns)
+{
+    char line[256], n[128];
+    double v;
+    rewind(f);
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%127s %lf", n, &v) == 2 && strcmp(n, name) == 0) {
+            *ns = v;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int bench_main(const BenchCase *cases, int ncases, int rounds,
+               const char *save, const char *baseline)
+{
+    FILE *out = NULL, *base = NULL;
+    int i;
+
+    if (save && !(out = fopen(save, "w"))) {
+        perror(save);
+        return 1;
+    }
+    if (baseline && !(base = fopen(baseline, "r"))) {
+        perror(baseline);
+        if (out) fclose(out);
+        return 1;
+    }
+    if (out) fprintf(out, "# name ns_per_call stddev calls_per_sec\n");
+
+    printf("%-28s %12s %10s %14s", "function", "ns/call", "stddev", "calls/sec");
+    if (base) printf(" %12s %8s", "base ns", "delta");
+    printf("\n");
+
+    for (i = 0; i < ncases; i++) {
+        BenchResult r = bench_run(&cases[i], rounds);
+        double b;
+        printf("%-28s %12.2f %10.2f %14.0f",
+               cases[i].name, r.ns_per_call, r.stddev, r.calls_per_sec);
+        if (base) {
+            if (baseline_lookup(base, cases[i].name, &b))
+                printf(" %12.2f %+7.1f%%", b, (r.ns_per_call - b) / b * 100.0);
+            else
+                printf(" %12s %8s", "-", "new");
+        }
+        printf("\n");
+        if (out)
+            fprintf(out, "%s %.4f %.4f %.0f\n",
+                    cases[i].name, r.ns_per_call, r.stddev, r.calls_per_sec);
+    }
+
+    if (out) fclose(out);
+    if (base) fclose(base);
+    return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * sunmooncalc_fixed against the double sunmooncalc: rise/set
+ * differences in minutes over a latitude/longitude grid and a year,
+ * and time and TSC cycles per call for both.
+ */
+#include <stdio.h>
+#include "bench.h"
+#include "solver_check.h"
+#include "sunmoon.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+typedef void (*solver)(double, float, float, float, int, float*, float*);
+
+static double run(solver f, long n)
+{
+    double s = 0;
+    float r, t;
+    long i;
+    for (i = 0; i < n; i++) {
+        f(CHECK_JD + i % CHECK_DAYS, -5.0, 33.9616, 83.4299, i & 1, &r, &t);
+        s += r + t;
+    }
+    return s;
+}
+
+static double b_double(long n) { return run(sunmooncalc, n); }
+static double b_fixed(long n)  { return run(sunmooncalc_fixed, n); }
+
+static void cycles(const char *name, solver f)
+{
+#ifdef HAVE_TSC
+    unsigned long long t0 = __rdtsc();
+    bench_sink += run(f, 20000);
+    printf("%-28s %12.0f TSC cycles/call\n", name, (__rdtsc() - t0) / 20000.0);
+#else
+    (void)name; (void)f;
+#endif
+}
+
+static void pair(int day, float lat, float lon, int obj, float want[2], float got[2])
+{
+    sunmooncalc(CHECK_JD + day, 0, lat, lon, obj, &want[0], &want[1]);
+    sunmooncalc_fixed(CHECK_JD + day, 0, lat, lon, obj, &got[0], &got[1]);
+}
+
+int main(void)
+{
+    BenchCase cases[] = {
+        { "sunmooncalc (double)", b_double, 20000 },
+        { "sunmooncalc_fixed",    b_fixed,  20000 },
+    };
+
+    check_table(pair, 1);
+    bench_main(cases, 2, 10, NULL, NULL);
+    cycles("sunmooncalc (double)", sunmooncalc);
+    cycles("sunmooncalc_fixed", sunmooncalc_fixed);
+    return 0;
+}
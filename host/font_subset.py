@@ -0,0 +1,345 @@
+#!/usr/bin/env python
+#
+# Derives the glyphs each custom font resource actually has to draw,
+# writes them to appinfo.json as the resource's characterRegex (which
+# makes the Pebble resource compiler emit only those glyphs) and
+# reports the font size before and after.
+#
+#   font_subset.py appinfo.json          update appinfo.json, print report
+#   font_subset.py --check appinfo.json  fail if appinfo.json is stale
+#
+# The glyphs each font needs are read from the sources: the field ->
+# font table in src/face.c, the field -> producer table in src/main.c,
+# and everything a producer can put into its text, following the
+# functions and constant tables it uses (timefmt.c's DAY_NAMES and
+# MONTH_NAMES, TWO_DIGITS, the printf formats, ...).  printf
+# conversions stand for the characters they can print.  Text that
+# comes from outside the code (EXTERNAL) and fonts whose glyphs are
+# picked by arithmetic (UNMANAGED) are listed here by hand.
+#
+# Sizes are estimates from the TrueType outlines: glyph bounding boxes
+# at the resource's pixel size, laid out like the SDK's font format
+# (hash table, offset table, 8-byte glyph header, 1-bit bitmap padded
+# to 32 bits).  The whole font lives in flash.  The RAM column is what
+# a loaded font keeps resident to draw: the header, hash and offset
+# tables the firmware looks glyphs up in, plus a buffer for the largest
+# glyph; bitmaps are read from flash as they are drawn.
+
+import json
+import os
+import re
+import struct
+import sys
+
+try:
+    unichr
+except NameError:
+    unichr = chr
+
+DIGITS = '0123456789'
+
+# condition text comes from the weather server: printable ASCII
+PRINTABLE = ''.join(unichr(c) for c in range(0x20, 0x7f))
+
+# expressions whose text does not come from the code
+EXTERNAL = {
+    'weather.cond': PRINTABLE,
+}
+
+# moon phase letters are worked out from the phase number
+UNMANAGED = ('FONT_MOON_PHASES_SUBSET_24',)
+
+# what a printf conversion can print
+CONVERSIONS = {'d': DIGITS + '-', 'i': DIGITS + '-', 'u': DIGITS,
+               'f': DIGITS + '-.', '%': '%', 's': '', 'c': ''}
+CONVERSION = re.compile(r'%[-+ 0#]*\d*(?:\.\d+)?(?:hh|h|ll|l)?([diufsc%])')
+
+# C library and printf, which add nothing of their own
+OPAQUE = ('mini_snprintf', 'mini_vsnprintf')
+
+
+def strip_comments(src):
+    """Source with comments blanked, string and char literals kept."""
+    return re.sub(r'//[^\n]*|/\*.*?\*/|("(?:[^"\\\n]|\\.)*"|\'(?:[^\'\\\n]|\\.)*\')',
+                  lambda m: m.group(1) or ' ', src, flags=re.S)
+
+
+def c_string(body):
+    """The text of a C string or char literal body, escapes resolved."""
+    out = bytearray()
+    i = 0
+    while i < len(body):
+        c = body[i]
+        if c != '\\':
+            out += c.encode('utf-8')
+            i += 1
+            continue
+        e = body[i + 1]
+        if e == 'x':
+            m = re.match(r'[0-9a-fA-F]+', body[i + 2:])
+            out.append(int(m.group(0), 16) & 0xff)
+            i += 2 + len(m.group(0))
+        elif e in '01234567':
+            m = re.match(r'[0-7]{1,3}', body[i + 1:])
+            out.append(int(m.group(0), 8) & 0xff)
+            i += 1 + len(m.group(0))
+        else:
+            out += {'n': b'\n', 't': b'\t', 'r': b'\r', '0': b'\0'}.get(e, e.encode('utf-8'))
+            i += 2
+    return out.decode('utf-8', 'replace')
+
+
+class Sources(object):
+    """Function bodies and constant tables of the watch sources, by name."""
+
+    def __init__(self, src_dir):
+        self.defs = {}
+        self.text = {}
+        for name in sorted(os.listdir(src_dir)):
+            if name.endswith('.c'):
+                with open(os.path.join(src_dir, name)) as f:
+                    self.text[name] = strip_comments(f.read())
+                self.scan(self.text[name])
+
+    def scan(self, src):
+        # functions: a signature at the start of a line, then its braces
+        for m in re.finditer(r'^[A-Za-z_][\w \t\*]*?\b(\w+)\s*\([^;{)]*\)\s*\{', src, re.M):
+            depth, i = 1, m.end()
+            while depth:
+                depth += {'{': 1, '}': -1}.get(src[i], 0)
+                i += 1
+            self.defs.setdefault(m.group(1), src[m.end():i - 1])
+        # constant tables and strings
+        for m in re.finditer(r'\bconst\b[^;=(]*?\b(\w+)\s*(?:\[[^\]]*\]\s*)+=([^;]*);', src):
+            self.defs.setdefault(m.group(1), m.group(2))
+
+    def glyphs(self, name, seen=None):
+        """Every character the code under name can produce."""
+        seen = set() if seen is None else seen
+        if name in seen or name in OPAQUE or name not in self.defs:
+            return set()
+        seen.add(name)
+        body = self.defs[name]
+        body = re.sub(r'\bAPP_LOG\s*\(.*?\);', '', body, flags=re.S)
+        # writable buffers: their initial text only sizes them
+        body = re.sub(r'\bchar\s+\w+\s*\[\w*\]\s*=\s*("(?:[^"\\]|\\.)*"\s*)+', '', body)
+        chars = set()
+        for expr, text in EXTERNAL.items():
+            if expr in body:
+                chars.update(text)
+        for m in re.finditer(r'"((?:[^"\\]|\\.)*)"', body):
+            text = c_string(m.group(1))
+            for conv in CONVERSION.finditer(text):
+                chars.update(CONVERSIONS[conv.group(1)])
+            chars.update(CONVERSION.sub('', text))
+        for m in re.finditer(r"'((?:[^'\\]|\\.)+)'(\s*\+)?", body):
+            # '0' + n: a digit worked out
+            chars.update(DIGITS if m.group(2) and m.group(1) == '0' else c_string(m.group(1)))
+        code = re.sub(r'"(?:[^"\\]|\\.)*"|\'(?:[^\'\\]|\\.)+\'', ' ', body)
+        for ident in set(re.findall(r'\b[A-Za-z_]\w*\b', code)):
+            chars |= self.glyphs(ident, seen)
+        chars.discard('\0')
+        return chars
+
+
+def table(src, name):
+    """[KEY] = { ... } entries of the initializer of table name."""
+    m = re.search(r'\b%s\s*\[[^\]]*\]\s*=\s*\{(.*?)\n\};' % name, src, re.S)
+    return re.findall(r'\[(\w+)\]\s*=\s*(\{[^}]*\}|[^,\n]+)', m.group(1))
+
+
+def derive_glyphs(src_dir):
+    """Resource name -> characters, from what the face draws with each font."""
+    sources = Sources(src_dir)
+    face, main = sources.text['face.c'], sources.text['main.c']
+    resources = dict((font, res.strip().replace('RESOURCE_ID_', ''))
+                     for font, res in table(face, 'FONT_RESOURCES'))
+    producers = dict((field, entry.strip('{} ').split(',')[1].strip())
+                     for field, entry in table(main, 'complications'))
+    glyphs = {}
+    for field, entry in table(face, 'fields'):
+        font = re.search(r'\b(FONT_\w+)', entry).group(1)
+        res = resources.get(font)
+        if res is None or res in UNMANAGED or producers.get(field, 'NULL') == 'NULL':
+            continue
+        glyphs.setdefault(res, set()).update(sources.glyphs(producers[field]))
+    return dict((res, u''.join(sorted(chars))) for res, chars in glyphs.items())
+
+
+PFO_HEADER = 8
+PFO_HASH_TABLE = 255 * 4
+PFO_OFFSET_ENTRY = 6
+PFO_GLYPH_HEADER = 8
+
+
+def char_class(chars):
+    """Smallest [...] regex class matching exactly chars."""
+    codes = sorted(set(ord(c) for c in chars))
+    runs = []
+    for c in codes:
+        if runs and runs[-1][1] == c - 1:
+            runs[-1][1] = c
+        else:
+            runs.append([c, c])
+
+    def esc(c):
+        ch = unichr(c)
+        return '\\' + ch if ch in '\\]^-[' else ch
+
+    out = ''
+    for lo, hi in runs:
+        if hi - lo >= 2:
+            out += esc(lo) + '-' + esc(hi)
+        else:
+            out += ''.join(esc(c) for c in range(lo, hi + 1))
+    return '[' + out + ']'
+
+
+class TrueType(object):
+    """Just enough of a TTF reader for cmap and glyph bounding boxes."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        ntables, = struct.unpack('>H', self.data[4:6])
+        self.tables = {}
+        for i in range(ntables):
+            tag, _, off, length = struct.unpack('>4sIII', self.data[12 + 16 * i:28 + 16 * i])
+            self.tables[tag.decode('latin-1')] = (off, length)
+        self.units_per_em, = struct.unpack('>H', self.table('head')[18:20])
+        self.long_loca, = struct.unpack('>h', self.table('head')[50:52])
+        self.cmap = self.read_cmap()
+
+    def table(self, tag):
+        off, length = self.tables[tag]
+        return self.data[off:off + length]
+
+    def read_cmap(self):
+        cmap = self.table('cmap')
+        n, = struct.unpack('>H', cmap[2:4])
+        for i in range(n):
+            pid, eid, off = struct.unpack('>HHI', cmap[4 + 8 * i:12 + 8 * i])
+            if struct.unpack('>H', cmap[off:off + 2])[0] == 4 and (pid, eid) in ((3, 1), (0, 3), (0, 4), (0, 0)):
+                return self.read_format4(cmap[off:])
+        raise ValueError('no Unicode BMP cmap')
+
+    def read_format4(self, sub):
+        segs = struct.unpack('>H', sub[6:8])[0] // 2
+        end = struct.unpack('>%dH' % segs, sub[14:14 + 2 * segs])
+        o = 16 + 2 * segs
+        start = struct.unpack('>%dH' % segs, sub[o:o + 2 * segs])
+        delta = struct.unpack('>%dh' % segs, sub[o + 2 * segs:o + 4 * segs])
+        ro = o + 4 * segs
+        rng = struct.unpack('>%dH' % segs, sub[ro:ro + 2 * segs])
+        cmap = {}
+        for s in range(segs):
+            for c in range(start[s], end[s] + 1):
+                if c == 0xffff:
+                    continue
+                if rng[s] == 0:
+                    g = (c + delta[s]) & 0xffff
+                else:
+                    p = ro + 2 * s + rng[s] + 2 * (c - start[s])
+                    g, = struct.unpack('>H', sub[p:p + 2])
+                    if g:
+                        g = (g + delta[s]) & 0xffff
+                if g:
+                    cmap[c] = g
+        return cmap
+
+    def bbox(self, glyph):
+        loca = self.table('loca')
+        if self.long_loca:
+            a, b = struct.unpack('>II', loca[4 * glyph:4 * glyph + 8])
+        else:
+            a, b = [2 * x for x in struct.unpack('>HH', loca[2 * glyph:2 * glyph + 4])]
+        if a == b:
+            return 0, 0, 0, 0
+        off = self.tables['glyf'][0] + a
+        return struct.unpack('>4h', self.data[off + 2:off + 10])
+
+    def pfo_size(self, codepoints, px):
+        """Estimated flash and resident RAM of the compiled font."""
+        scale = float(px) / self.units_per_em
+        tables = PFO_HEADER + PFO_HASH_TABLE + PFO_OFFSET_ENTRY * len(codepoints)
+        flash = tables
+        largest = 0
+        for c in codepoints:
+            x0, y0, x1, y1 = self.bbox(self.cmap[c])
+            w = int((x1 - x0) * scale + 0.999)
+            h = int((y1 - y0) * scale + 0.999)
+            glyph = PFO_GLYPH_HEADER + (w * h + 31) // 32 * 4
+            flash += glyph
+            largest = max(largest, glyph)
+        return flash, tables + largest
+
+
+def main(argv):
+    check = '--check' in argv
+    args = [a for a in argv[1:] if a != '--check']
+    if len(args) != 1:
+        sys.stderr.write('usage: font_subset.py [--check] appinfo.json\n')
+        return 2
+    appinfo_path = args[0]
+    fonts_dir = os.path.join(os.path.dirname(appinfo_path) or '.', 'resources')
+    glyphs = derive_glyphs(os.path.join(os.path.dirname(appinfo_path) or '.', 'src'))
+    with open(appinfo_path) as f:
+        text = f.read()
+    media = json.loads(text)['resources']['media']
+
+    stale = []
+    total = [0, 0, 0, 0]
+    print('%-28s %7s %7s %9s %9s %7s %7s' % ('resource', 'glyphs', 'after', 'flash', 'after', 'ram', 'after'))
+    for res in media:
+        name = res['name']
+        if res['type'] != 'font' or name not in glyphs:
+            continue
+        ttf = TrueType(os.path.join(fonts_dir, res['file']))
+        px = int(re.search(r'_(\d+)$', name).group(1))
+        wanted = set(ord(c) for c in glyphs[name])
+        missing = sorted(c for c in wanted if c not in ttf.cmap)
+        keep = sorted(c for c in wanted if c in ttf.cmap)
+        regex = char_class(u''.join(unichr(c) for c in keep))
+
+        full = sorted(c for c in ttf.cmap if c >= 0x20)
+        sizes = ttf.pfo_size(full, px) + ttf.pfo_size(keep, px)
+        flash_before, ram_before, flash_after, ram_after = sizes
+        total = [t + n for t, n in zip(total, (flash_before, flash_after, ram_before, ram_after))]
+        print('%-28s %7d %7d %9d %9d %7d %7d' % (name, len(full), len(keep),
+                                                 flash_before, flash_after, ram_before, ram_after))
+        if missing:
+            sys.stderr.write('%s: %s lacks %s\n' % (name, res['file'],
+                                                   ' '.join('U+%04X' % c for c in missing)))
+
+        if res.get('characterRegex') != regex:
+            stale.append(name)
+            # rewrite only this resource's entry, keeping the file's layout
+            entry = re.compile(r'(\{[^{}]*"name": "%s"[^{}]*\})' % name)
+            block = entry.search(text).group(1)
+            if '"characterRegex"' in block:
+                new = re.sub(r'"characterRegex": "(?:[^"\\\\]|\\\\.)*"',
+                             lambda m: '"characterRegex": %s' % json.dumps(regex), block)
+            else:
+                indent = re.search(r'\n(\s*)"type"', block).group(1)
+                new = block.replace('\n%s"type"' % indent,
+                                    '\n%s"characterRegex": %s,\n%s"type"' %
+                                    (indent, json.dumps(regex), indent), 1)
+            text = text.replace(block, new)
+
+    print('%-28s %7s %7s %9d %9d %7d %7d' % (('total', '', '') + tuple(total)))
+
+    if check:
+        if stale:
+            sys.stderr.write('appinfo.json font subsets are out of date (%s); run make -C host fonts\n'
+                             % ', '.join(stale))
+            return 1
+        return 0
+    if stale:
+        with open(appinfo_path, 'w') as f:
+            f.write(text)
+        print('updated characterRegex of %s' % ', '.join(stale))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,49 @@
+/*
+ * sunmooncalc_interp against sunmooncalc: rise/set differences in
+ * minutes over a year at a spread of latitudes, and the speedup.
+ */
+#include <stdio.h>
+#include "bench.h"
+#include "solver_check.h"
+#include "sunmoon.h"
+
+static double b_exact(long n)
+{
+    double s = 0;
+    float r, t;
+    long i;
+    for (i = 0; i < n; i++) {
+        sunmooncalc(CHECK_JD + i % CHECK_DAYS, -5.0, 33.9616, 83.4299, i & 1, &r, &t);
+        s += r + t;
+    }
+    return s;
+}
+
+static double b_interp(long n)
+{
+    double s = 0;
+    float r, t;
+    long i;
+    for (i = 0; i < n; i++) {
+        sunmooncalc_interp(CHECK_JD + i % CHECK_DAYS, -5.0, 33.9616, 83.4299, i & 1, &r, &t);
+        s += r + t;
+    }
+    return s;
+}
+
+static void pair(int day, float lat, float lon, int obj, float want[2], float got[2])
+{
+    sunmooncalc(CHECK_JD + day, 0, lat, lon, obj, &want[0], &want[1]);
+    sunmooncalc_interp(CHECK_JD + day, 0, lat, lon, obj, &got[0], &got[1]);
+}
+
+int main(void)
+{
+    BenchCase cases[] = {
+        { "sunmooncalc (sun+moon)",        b_exact,  20000 },
+        { "sunmooncalc_interp (sun+moon)", b_interp, 20000 },
+    };
+
+    check_table(pair, 0);
+    return bench_main(cases, 2, 10, NULL, NULL);
+}
@@ -0,0 +1,900 @@
+/*
+ * Host implementation of the Pebble API subset in pebble/pebble.h, see
+ * pebble_shim.h for the simulator's side.
+ *
+ * Rendering follows the SDK: marking any layer dirty schedules one
+ * render of the window, which walks the layer tree in order and paints
+ * every visible layer (text layers with a font and text, bitmap layers
+ * with a bitmap, plain layers through their update proc).  A window
+ * with a background colour is filled first; GColorClear leaves the
+ * frame buffer as the last frame left it.
+ *
+ * Heap use counts what the SDK would allocate in the app heap for each
+ * object, including the pixels of bitmaps loaded from resources.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "pebble_shim.h"
+
+#define SCREEN_W     144
+#define SCREEN_H     168
+#define APP_HEAP     (24 * 1024)
+#define MAX_TIMERS   8
+#define MAX_PERSIST  16
+#define MAX_DICT     256
+
+ShimCounters shim_counters;
+bool shim_clock_24h;
+bool shim_verbose;
+const char *shim_resources = "../resources";
+
+/* allocations, with the size in front for the accounting */
+static size_t heap_used, heap_peak;
+static int live_objects;
+
+static void *shim_alloc(size_t size)
+{
+    size_t *p = calloc(1, sizeof(size_t) + size);
+    *p = size;
+    heap_used += size;
+    if (heap_used > heap_peak) heap_peak = heap_used;
+    live_objects++;
+    return p + 1;
+}
+
+static void shim_free(void *ptr)
+{
+    size_t *p = (size_t *)ptr - 1;
+    if (ptr == NULL) return;
+    heap_used -= *p;
+    live_objects--;
+    free(p);
+}
+
+size_t heap_bytes_used(void)
+{
+    return heap_used;
+}
+
+size_t heap_bytes_free(void)
+{
+    return heap_used < APP_HEAP ? APP_HEAP - heap_used : 0;
+}
+
+size_t shim_heap_peak(void)
+{
+    return heap_peak;
+}
+
+int shim_live_objects(void)
+{
+    return live_objects;
+}
+
+void shim_reset_counters(void)
+{
+    memset(&shim_counters, 0, sizeof(shim_counters));
+}
+
+/* clock */
+static long long clock_ms;
+static struct tm local_tm;
+
+void shim_set_clock(long long ms)
+{
+    clock_ms = ms;
+}
+
+long long shim_clock(void)
+{
+    return clock_ms;
+}
+
+time_t shim_time(time_t *tloc)
+{
+    time_t t = clock_ms / 1000;
+    if (tloc) *tloc = t;
+    return t;
+}
+
+struct tm *shim_localtime(const time_t *timep)
+{
+    return gmtime_r(timep, &local_tm);
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms)
+{
+    uint16_t ms = clock_ms % 1000;
+    if (tloc) *tloc = clock_ms / 1000;
+    if (out_ms) *out_ms = ms;
+    return ms;
+}
+
+uint32_t profile_ns(void)
+{
+    return (uint32_t)bench_now_ns();
+}
+
+bool clock_is_24h_style(void)
+{
+    return shim_clock_24h;
+}
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...)
+{
+    va_list va;
+    time_t t = clock_ms / 1000;
+    struct tm tm;
+    char when[24];
+
+    if (!shim_verbose) return;
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", gmtime_r(&t, &tm));
+    printf("[%s] %s:%d ", when, src_filename, src_line_number);
+    va_start(va, fmt);
+    vprintf(fmt, va);
+    va_end(va);
+    putchar('\n');
+}
+
+/* tick service */
+static TimeUnits tick_units;
+static TickHandler tick_handler;
+
+void tick_timer_service_subscribe(TimeUnits units, TickHandler handler)
+{
+    tick_units = units;
+    tick_handler = handler;
+}
+
+void tick_timer_service_unsubscribe(void)
+{
+    tick_handler = NULL;
+}
+
+TimeUnits shim_tick_units(void)
+{
+    return tick_units;
+}
+
+TickHandler shim_tick_handler(void)
+{
+    return tick_handler;
+}
+
+/* timers */
+struct AppTimer {
+    long long due;
+    AppTimerCallback callback;
+    void *data;
+};
+
+static AppTimer *timers[MAX_TIMERS];
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data)
+{
+    int i;
+    for (i = 0; i < MAX_TIMERS; i++) {
+        if (timers[i] == NULL) {
+            timers[i] = shim_alloc(sizeof(AppTimer));
+            timers[i]->due = clock_ms + timeout_ms;
+            timers[i]->callback = callback;
+            timers[i]->data = callback_data;
+            return timers[i];
+        }
+    }
+    return NULL;
+}
+
+void app_timer_cancel(AppTimer *timer)
+{
+    int i;
+    for (i = 0; i < MAX_TIMERS; i++) {
+        if (timers[i] == timer && timer != NULL) {
+            shim_free(timer);
+            timers[i] = NULL;
+        }
+    }
+}
+
+static int next_timer(void)
+{
+    int i, next = -1;
+    for (i = 0; i < MAX_TIMERS; i++)
+        if (timers[i] && (next < 0 || timers[i]->due < timers[next]->due)) next = i;
+    return next;
+}
+
+long long shim_next_timer(void)
+{
+    int i = next_timer();
+    return i < 0 ? -1 : timers[i]->due;
+}
+
+void shim_jump_clock(long long ms)
+{
+    int i;
+    clock_ms += ms;
+    for (i = 0; i < MAX_TIMERS; i++)
+        if (timers[i]) timers[i]->due += ms;
+}
+
+void shim_run_timer(void)
+{
+    int i = next_timer();
+    AppTimer t;
+    if (i < 0) return;
+    t = *timers[i];
+    shim_free(timers[i]);
+    timers[i] = NULL;
+    t.callback(t.data);
+}
+
+/* graphics: count what would be painted */
+struct GContext {
+    GColor text_color, fill_color;
+};
+
+static GContext context;
+static bool frame_pending;
+
+static unsigned long area(GRect r)
+{
+    return (unsigned long)(r.size.w > 0 ? r.size.w : 0) * (r.size.h > 0 ? r.size.h : 0);
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color)
+{
+    ctx->text_color = color;
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color)
+{
+    ctx->fill_color = color;
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, int corner_mask)
+{
+    shim_counters.pixels += area(rect);
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect)
+{
+    if (bitmap == NULL) return;
+    shim_counters.bitmaps++;
+    shim_counters.pixels += area(rect);
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        const GTextLayoutCacheRef layout)
+{
+    if (text == NULL || font == NULL) return;
+    shim_counters.texts++;
+    shim_counters.pixels += area(box);
+}
+
+/* resources: the files appinfo.json names, read on first use */
+struct ResourceHandle {
+    const char *file;
+    uint8_t *data;
+    long size;
+};
+
+static struct ResourceHandle resources[] = {
+    [RESOURCE_ID_BG_IMAGE]                  = { "images/BG.png" },
+    [RESOURCE_ID_ICON_ATLAS_BLACK]          = { "images/atlas.png" },
+    [RESOURCE_ID_FONT_ROBOTO_CONDENSED_20]  = { "fonts/Roboto-Condensed.ttf" },
+    [RESOURCE_ID_FONT_ROBOTO_BOLD_SUBSET_41] = { "fonts/Roboto-Bold.ttf" },
+    [RESOURCE_ID_FONT_FUTURA_CONDITIONS_12] = { "fonts/futura.ttf" },
+    [RESOURCE_ID_FONT_FUTURA_TEMP_18]       = { "fonts/futura.ttf" },
+    [RESOURCE_ID_PIC_FAHR]                  = { "images/Fahr.png" },
+    [RESOURCE_ID_FONT_MOON_PHASES_SUBSET_24] = { "fonts/moon_phases.ttf" },
+    [RESOURCE_ID_ALMANAC]                   = { "data/almanac.bin" },
+    [RESOURCE_ID_IMAGE_MENU_ICON]           = { "images/menuicon.png" },
+};
+
+ResHandle resource_get_handle(uint32_t resource_id)
+{
+    ResHandle h;
+    char path[1024];
+    FILE *f;
+
+    if (resource_id == 0 || resource_id >= ARRAY_LENGTH(resources)) return NULL;
+    h = &resources[resource_id];
+    if (h->data == NULL && h->size == 0) {
+        snprintf(path, sizeof(path), "%s/%s", shim_resources, h->file);
+        h->size = -1;
+        if ((f = fopen(path, "rb")) != NULL) {
+            fseek(f, 0, SEEK_END);
+            h->size = ftell(f);
+            rewind(f);
+            h->data = malloc(h->size);
+            if (fread(h->data, 1, h->size, f) != (size_t)h->size) h->size = -1;
+            fclose(f);
+        }
+    }
+    return h;
+}
+
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t *buffer, size_t num_bytes)
+{
+    if (h == NULL || h->size < 0 || start_offset >= h->size) return 0;
+    if (num_bytes > h->size - start_offset) num_bytes = h->size - start_offset;
+    memcpy(buffer, h->data + start_offset, num_bytes);
+    return num_bytes;
+}
+
+/* bitmaps: just their bounds; a resource bitmap owns 1-bit pixel rows */
+struct GBitmap {
+    GRect bounds;
+    bool owns_pixels;
+};
+
+static size_t bitmap_bytes(GRect r)
+{
+    return (size_t)(r.size.w + 31) / 32 * 4 * r.size.h;
+}
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id)
+{
+    ResHandle h = resource_get_handle(resource_id);
+    GRect bounds = GRect(0, 0, SCREEN_W, SCREEN_H);
+    GBitmap *b;
+
+    /* size from the PNG header */
+    if (h && h->size >= 24 && !memcmp(h->data + 12, "IHDR", 4)) {
+        bounds.size.w = h->data[18] << 8 | h->data[19];
+        bounds.size.h = h->data[22] << 8 | h->data[23];
+    }
+    b = shim_alloc(sizeof(GBitmap) + bitmap_bytes(bounds));
+    b->bounds = bounds;
+    b->owns_pixels = true;
+    return b;
+}
+
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect)
+{
+    GBitmap *b = shim_alloc(sizeof(GBitmap));
+    b->bounds = sub_rect;
+    return b;
+}
+
+void gbitmap_destroy(GBitmap *bitmap)
+{
+    shim_free(bitmap);
+}
+
+/* fonts */
+struct FontInfo {
+    ResHandle resource;
+};
+
+static struct FontInfo system_font;
+
+GFont fonts_get_system_font(const char *font_key)
+{
+    return &system_font;
+}
+
+GFont fonts_load_custom_font(ResHandle handle)
+{
+    GFont font = shim_alloc(sizeof(struct FontInfo));
+    font->resource = handle;
+    return font;
+}
+
+void fonts_unload_custom_font(GFont font)
+{
+    shim_free(font);
+}
+
+/* layers */
+enum { LAYER_PLAIN, LAYER_TEXT, LAYER_BITMAP };
+
+struct Layer {
+    GRect frame;
+    bool hidden;
+    int kind;
+    LayerUpdateProc update_proc;
+    Layer *parent, *first_child, *next_sibling;
+};
+
+struct TextLayer {
+    Layer layer;
+    const char *text;
+    GFont font;
+};
+
+struct BitmapLayer {
+    Layer layer;
+    const GBitmap *bitmap;
+};
+
+struct Window {
+    Layer root;
+    WindowHandlers handlers;
+    GColor background;
+};
+
+static Window *top_window;
+
+static void layer_init(Layer *layer, GRect frame, int kind)
+{
+    layer->frame = frame;
+    layer->kind = kind;
+}
+
+Layer *layer_create(GRect frame)
+{
+    Layer *layer = shim_alloc(sizeof(Layer));
+    layer_init(layer, frame, LAYER_PLAIN);
+    return layer;
+}
+
+void layer_destroy(Layer *layer)
+{
+    if (layer == NULL) return;
+    layer_remove_from_parent(layer);
+    shim_free(layer);
+}
+
+void layer_mark_dirty(Layer *layer)
+{
+    shim_counters.marks++;
+    frame_pending = true;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc)
+{
+    layer->update_proc = update_proc;
+}
+
+GRect layer_get_frame(const Layer *layer)
+{
+    return layer->frame;
+}
+
+GRect layer_get_bounds(const Layer *layer)
+{
+    return GRect(0, 0, layer->frame.size.w, layer->frame.size.h);
+}
+
+void layer_add_child(Layer *parent, Layer *child)
+{
+    Layer **p = &parent->first_child;
+    layer_remove_from_parent(child);
+    while (*p) p = &(*p)->next_sibling;
+    *p = child;
+    child->parent = parent;
+    layer_mark_dirty(parent);
+}
+
+void layer_remove_from_parent(Layer *child)
+{
+    Layer **p;
+    if (child->parent == NULL) return;
+    for (p = &child->parent->first_child; *p; p = &(*p)->next_sibling) {
+        if (*p == child) {
+            *p = child->next_sibling;
+            break;
+        }
+    }
+    layer_mark_dirty(child->parent);
+    child->parent = child->next_sibling = NULL;
+}
+
+void layer_insert_below_sibling(Layer *layer, Layer *sibling)
+{
+    Layer **p;
+    layer_remove_from_parent(layer);
+    for (p = &sibling->parent->first_child; *p != sibling; p = &(*p)->next_sibling)
+        ;
+    layer->next_sibling = sibling;
+    layer->parent = sibling->parent;
+    *p = layer;
+    layer_mark_dirty(layer->parent);
+}
+
+void layer_set_hidden(Layer *layer, bool hidden)
+{
+    if (layer->hidden != hidden) {
+        layer->hidden = hidden;
+        layer_mark_dirty(layer);
+    }
+}
+
+TextLayer *text_layer_create(GRect frame)
+{
+    TextLayer *t = shim_alloc(sizeof(TextLayer));
+    layer_init(&t->layer, frame, LAYER_TEXT);
+    t->font = &system_font;
+    return t;
+}
+
+void text_layer_destroy(TextLayer *text_layer)
+{
+    if (text_layer == NULL) return;
+    layer_remove_from_parent(&text_layer->layer);
+    shim_free(text_layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer)
+{
+    return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text)
+{
+    text_layer->text = text;
+    layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font)
+{
+    text_layer->font = font;
+    layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color)
+{
+    layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color)
+{
+    layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment)
+{
+    layer_mark_dirty(&text_layer->layer);
+}
+
+BitmapLayer *bitmap_layer_create(GRect frame)
+{
+    BitmapLayer *b = shim_alloc(sizeof(BitmapLayer));
+    layer_init(&b->layer, frame, LAYER_BITMAP);
+    return b;
+}
+
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer)
+{
+    if (bitmap_layer == NULL) return;
+    layer_remove_from_parent(&bitmap_layer->layer);
+    shim_free(bitmap_layer);
+}
+
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer)
+{
+    return (Layer *)&bitmap_layer->layer;
+}
+
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap)
+{
+    bitmap_layer->bitmap = bitmap;
+    layer_mark_dirty(&bitmap_layer->layer);
+}
+
+/* windows */
+Window *window_create(void)
+{
+    Window *w = shim_alloc(sizeof(Window));
+    layer_init(&w->root, GRect(0, 0, SCREEN_W, SCREEN_H), LAYER_PLAIN);
+    w->background = GColorWhite;
+    return w;
+}
+
+void window_destroy(Window *window)
+{
+    if (window == top_window) {
+        if (window->handlers.unload) window->handlers.unload(window);
+        top_window = NULL;
+    }
+    shim_free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers)
+{
+    window->handlers = handlers;
+}
+
+Layer *window_get_root_layer(const Window *window)
+{
+    return (Layer *)&window->root;
+}
+
+void window_set_background_color(Window *window, GColor background_color)
+{
+    window->background = background_color;
+}
+
+void window_stack_push(Window *window, bool animated)
+{
+    top_window = window;
+    if (window->handlers.load) window->handlers.load(window);
+    frame_pending = true;
+}
+
+static void render_layer(Layer *layer)
+{
+    Layer *child;
+    if (layer->hidden) return;
+
+    switch (layer->kind) {
+    case LAYER_TEXT: {
+        TextLayer *t = (TextLayer *)layer;
+        shim_counters.layers++;
+        graphics_draw_text(&context, t->text, t->font, layer->frame,
+                           GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
+        break;
+    }
+    case LAYER_BITMAP:
+        shim_counters.layers++;
+        graphics_draw_bitmap_in_rect(&context, ((BitmapLayer *)layer)->bitmap, layer->frame);
+        break;
+    default:
+        if (layer->update_proc) {
+            shim_counters.layers++;
+            layer->update_proc(layer, &context);
+        }
+        break;
+    }
+    for (child = layer->first_child; child; child = child->next_sibling) render_layer(child);
+}
+
+bool shim_render(void)
+{
+    if (!frame_pending || top_window == NULL) return false;
+    frame_pending = false;
+    shim_counters.frames++;
+    if (top_window->background != GColorClear)
+        graphics_fill_rect(&context, top_window->root.frame, 0, 0);
+    render_layer(&top_window->root);
+    return true;
+}
+
+/* services */
+static BatteryChargeState battery = { 80, false, false };
+static BatteryStateHandler battery_handler;
+static bool connected = true;
+static BluetoothConnectionHandler bluetooth_handler;
+static AccelTapHandler tap_handler;
+
+void vibes_short_pulse(void)
+{
+    shim_counters.vibes++;
+}
+
+BatteryChargeState battery_state_service_peek(void)
+{
+    return battery;
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler)
+{
+    battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void)
+{
+    battery_handler = NULL;
+}
+
+void shim_battery(BatteryChargeState state)
+{
+    battery = state;
+    if (battery_handler) battery_handler(state);
+}
+
+bool bluetooth_connection_service_peek(void)
+{
+    return connected;
+}
+
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler)
+{
+    bluetooth_handler = handler;
+}
+
+void bluetooth_connection_service_unsubscribe(void)
+{
+    bluetooth_handler = NULL;
+}
+
+void shim_bluetooth(bool is_connected)
+{
+    connected = is_connected;
+    if (bluetooth_handler) bluetooth_handler(is_connected);
+}
+
+void accel_tap_service_subscribe(AccelTapHandler handler)
+{
+    tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe(void)
+{
+    tap_handler = NULL;
+}
+
+void shim_tap(void)
+{
+    if (tap_handler) tap_handler(ACCEL_AXIS_Z, 1);
+}
+
+/* app messages */
+static AppMessageInboxReceived inbox_handler;
+static AppMessageOutboxFailed outbox_failed_handler;
+static bool message_open;
+static uint32_t inbox_size;     /* what app_message_open asked for */
+static uint8_t inbox[MAX_DICT], outbox[MAX_DICT];
+static DictionaryIterator outbox_iter;
+
+static Tuple *next_tuple(const Tuple *t)
+{
+    return (Tuple *)((const uint8_t *)t + sizeof(Tuple) + t->length);
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key)
+{
+    Tuple *t = iter->dictionary->head;
+    int i;
+    for (i = 0; i < iter->dictionary->count; i++, t = next_tuple(t))
+        if (t->key == key) return t;
+    return NULL;
+}
+
+static DictionaryResult dict_write(DictionaryIterator *iter, uint32_t key, TupleType type,
+                                   const void *data, uint16_t length)
+{
+    Tuple *t = iter->cursor;
+    if ((const uint8_t *)t + sizeof(Tuple) + length > (const uint8_t *)iter->end)
+        return DICT_NOT_ENOUGH_STORAGE;
+    t->key = key;
+    t->type = type;
+    t->length = length;
+    memcpy(t->value->data, data, length);
+    iter->dictionary->count++;
+    iter->cursor = next_tuple(t);
+    return DICT_OK;
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value)
+{
+    return dict_write(iter, key, TUPLE_UINT, &value, 1);
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound)
+{
+    message_open = true;
+    inbox_size = size_inbound < MAX_DICT ? size_inbound : MAX_DICT;
+    return APP_MSG_OK;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback)
+{
+    AppMessageInboxReceived old = inbox_handler;
+    inbox_handler = received_callback;
+    return old;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback)
+{
+    AppMessageOutboxFailed old = outbox_failed_handler;
+    outbox_failed_handler = failed_callback;
+    return old;
+}
+
+void app_message_deregister_callbacks(void)
+{
+    inbox_handler = NULL;
+    outbox_failed_handler = NULL;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator)
+{
+    if (!message_open) return APP_MSG_BUSY;
+    outbox_iter.dictionary = (Dictionary *)outbox;
+    outbox_iter.dictionary->count = 0;
+    outbox_iter.cursor = outbox_iter.dictionary->head;
+    outbox_iter.end = outbox + sizeof(outbox);
+    *iterator = &outbox_iter;
+    return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_send(void)
+{
+    if (!connected) {
+        if (outbox_failed_handler) outbox_failed_handler(&outbox_iter, APP_MSG_NOT_CONNECTED, NULL);
+        return APP_MSG_NOT_CONNECTED;
+    }
+    shim_counters.sent++;
+    return APP_MSG_OK;
+}
+
+void shim_receive(const ShimBytes *tuples, int count)
+{
+    DictionaryIterator iter;
+    int i;
+    if (!message_open || inbox_handler == NULL) return;
+    iter.dictionary = (Dictionary *)inbox;
+    iter.dictionary->count = 0;
+    iter.cursor = iter.dictionary->head;
+    iter.end = inbox + inbox_size;
+    for (i = 0; i < count; i++) {
+        if (dict_write(&iter, tuples[i].key, TUPLE_BYTE_ARRAY, tuples[i].data, tuples[i].length) != DICT_OK) {
+            /* the watch drops a message that does not fit its inbox */
+            shim_counters.dropped++;
+            return;
+        }
+    }
+    iter.cursor = iter.dictionary->head;
+    inbox_handler(&iter, NULL);
+}
+
+void shim_receive_bytes(uint32_t key, const uint8_t *data, uint16_t length)
+{
+    ShimBytes tuple = { key, data, length };
+    shim_receive(&tuple, 1);
+}
+
+/* persistent storage */
+static struct {
+    bool used;
+    uint32_t key;
+    int length;
+    uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} store[MAX_PERSIST];
+
+static int persist_slot(uint32_t key, bool create)
+{
+    int i, free_slot = -1;
+    for (i = 0; i < MAX_PERSIST; i++) {
+        if (store[i].used && store[i].key == key) return i;
+        if (!store[i].used && free_slot < 0) free_slot = i;
+    }
+    if (create && free_slot >= 0) {
+        store[free_slot].used = true;
+        store[free_slot].key = key;
+    }
+    return create ? free_slot : -1;
+}
+
+bool persist_exists(const uint32_t key)
+{
+    return persist_slot(key, false) >= 0;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size)
+{
+    int i = persist_slot(key, false), n;
+    if (i < 0) return -1;
+    n = store[i].length < (int)buffer_size ? store[i].length : (int)buffer_size;
+    memcpy(buffer, store[i].data, n);
+    return n;
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size)
+{
+    int i = persist_slot(key, true);
+    int n = size < PERSIST_DATA_MAX_LENGTH ? (int)size : PERSIST_DATA_MAX_LENGTH;
+    if (i < 0) return -1;
+    shim_counters.persisted++;
+    memcpy(store[i].data, data, n);
+    store[i].length = n;
+    return n;
+}
+
+int32_t persist_read_int(const uint32_t key)
+{
+    int32_t value = 0;
+    persist_read_data(key, &value, sizeof(value));
+    return value;
+}
+
+int persist_write_int(const uint32_t key, const int32_t value)
+{
+    return persist_write_data(key, &value, sizeof(value));
+}
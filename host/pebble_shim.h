@@ -0,0 +1,69 @@
+/*
+ * The simulator's side of the host Pebble shim (pebble/pebble.h): the
+ * simulated clock, event injection and what the watch code asked the
+ * UI to do.
+ */
+#ifndef PEBBLE_SHIM_DRIVER_H
+#define PEBBLE_SHIM_DRIVER_H
+
+#include <pebble.h>
+
+/* UI work since the last shim_reset_counters() */
+typedef struct {
+    unsigned long marks;        /* layer_mark_dirty and text/bitmap layer setters */
+    unsigned long frames;       /* renders of the window */
+    unsigned long layers;       /* layers painted, update procs run */
+    unsigned long texts;        /* strings drawn */
+    unsigned long bitmaps;      /* bitmaps drawn */
+    unsigned long long pixels;  /* area of everything painted */
+    unsigned long vibes;
+    unsigned long sent;         /* app messages sent to the phone */
+    unsigned long dropped;      /* messages from the phone too big for the inbox */
+    unsigned long persisted;    /* persist_write_* calls */
+} ShimCounters;
+
+extern ShimCounters shim_counters;
+
+/* settings the watch code reads */
+extern bool shim_clock_24h;
+extern bool shim_verbose;               /* print APP_LOG output */
+extern const char *shim_resources;      /* resources/ directory */
+
+/* simulated local time, ms since the epoch */
+void shim_set_clock(long long ms);
+long long shim_clock(void);
+/* set the clock by ms, as the owner would; app timers keep their delay */
+void shim_jump_clock(long long ms);
+
+/* tick service subscription */
+TimeUnits shim_tick_units(void);
+TickHandler shim_tick_handler(void);
+
+/* due time of the next timer, or -1; shim_run_timer fires it */
+long long shim_next_timer(void);
+void shim_run_timer(void);
+
+/* render the window if something was marked; true if it did */
+bool shim_render(void);
+
+/* events from the outside */
+void shim_tap(void);
+void shim_battery(BatteryChargeState state);
+void shim_bluetooth(bool connected);
+
+/* one message from the phone: byte array tuples, dropped if the inbox
+   main.c opened is too small */
+typedef struct {
+    uint32_t key;
+    const uint8_t *data;
+    uint16_t length;
+} ShimBytes;
+
+void shim_receive(const ShimBytes *tuples, int count);
+void shim_receive_bytes(uint32_t key, const uint8_t *data, uint16_t length);
+
+void shim_reset_counters(void);
+size_t shim_heap_peak(void);
+int shim_live_objects(void);
+
+#endif // PEBBLE_SHIM_DRIVER_H
@@ -0,0 +1,212 @@
+/*
+ * Random formats through mini_snprintf (src/mini-printf.c) against the
+ * C library's snprintf: same text, truncated to the same buffer, and
+ * the return value is the number of characters written.
+ *
+ *   ./printf_fuzz [iterations [seed]]
+ *
+ * Formats are literal text with up to three conversions out of what
+ * mini_snprintf supports: %[-][0][width](d|u|x|X|c|s|%) and
+ * %[-][0][width][.prec]f.  %f gets mostly float values (what the watch
+ * passes), but also doubles with all 53 bits, subnormals, NaN and
+ * infinity; mini_snprintf prints values at or above 9.2e18 / 10^prec as
+ * inf, so those are left out.
+ */
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mini-printf.h"
+
+#define MAX_CONV 3
+#define BUF_MAX  64
+
+enum { T_INT, T_STR, T_DBL };
+
+typedef struct {
+    int i;
+    const char *s;
+    double d;
+} Arg;
+
+static const char *const strings[] = {
+    "", "a", "PM", "18:07", "Light Snow Showers", "just now", "Scattered Thunderstorms",
+};
+
+static unsigned long long rng_state;
+
+static unsigned rnd(unsigned n)
+{
+    rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned)(rng_state >> 33) % n;
+}
+
+static int rand_int(void)
+{
+    static const int edge[] = { 0, 1, -1, 9, 10, 99, 100, -100, INT_MAX, INT_MIN, 65535 };
+    switch (rnd(4)) {
+    case 0:  return edge[rnd(sizeof(edge) / sizeof(edge[0]))];
+    case 1:  return (int)rnd(200) - 100;
+    default: return (int)((unsigned)rnd(1u << 16) << 16 | rnd(1u << 16));
+    }
+}
+
+static double rand_float(void)
+{
+    static const double special[] = { 0.0, -0.0, 4.9e-324, -2.2e-308, 0.5, 2.5, -1e-300 };
+    double d;
+    float v;
+    switch (rnd(6)) {
+    case 4:
+        switch (rnd(4)) {
+        case 0:  return NAN;
+        case 1:  return -NAN;
+        case 2:  return rnd(2) ? INFINITY : -INFINITY;
+        default: return special[rnd(sizeof(special) / sizeof(special[0]))];
+        }
+    case 5:     /* a full double below 2^35 */
+        d = (double)((unsigned long long)rnd(1u << 26) << 27 | rnd(1u << 27));
+        return d / (double)(1ULL << (18 + rnd(36))) * (rnd(2) ? -1 : 1);
+    }
+    switch (rnd(4)) {
+    case 0:     /* ties at the rounding digit */
+        v = (float)((int)rnd(20000) - 10000) / 4;
+        break;
+    case 1:
+        v = (float)((int)rnd(2000000) - 1000000) / 1000;
+        break;
+    case 2:
+        v = (float)rnd(1000) * 1e-5f * (rnd(2) ? -1 : 1);
+        break;
+    default:
+        v = (float)rnd(1u << 30) * (float)(1 << rnd(10));
+        break;
+    }
+    return v;
+}
+
+/* random format in buf, argument types in type[] (unused slots int) */
+static void rand_format(char *fmt, int *type, Arg *arg)
+{
+    static const char conv[] = "duxXcsf%";
+    char *p = fmt;
+    int n = 0, k;
+
+    for (k = 0; k < MAX_CONV; k++) {
+        type[k] = T_INT;
+        arg[k].i = 0;
+    }
+    while (n < MAX_CONV && rnd(5)) {
+        int lit = rnd(4), c = conv[rnd(sizeof(conv) - 1)];
+        while (lit--) *p++ = " :.-AaZz09\xc2\xb0"[rnd(12)];
+        *p++ = '%';
+        if (c != '%') {
+            if (!rnd(4)) *p++ = '-';
+            if (!rnd(3) && c != 's' && c != 'c') *p++ = '0';
+            if (rnd(2)) p += sprintf(p, "%u", rnd(21));
+            if (c == 'f') {
+                int prec = (int)rnd(8) - 1;
+                if (prec >= 0) p += sprintf(p, ".%d", prec);
+                arg[n].d = rand_float();
+                type[n] = T_DBL;
+            } else if (c == 's') {
+                arg[n].s = strings[rnd(sizeof(strings) / sizeof(strings[0]))];
+                type[n] = T_STR;
+            } else if (c == 'c') {
+                arg[n].i = ' ' + rnd(95);
+            } else {
+                arg[n].i = rand_int();
+            }
+            n++;
+        }
+        *p++ = c;
+    }
+    if (rnd(2)) *p++ = '.';
+    *p = '\0';
+}
+
+#define I(k) arg[k].i
+#define S(k) arg[k].s
+#define D(k) arg[k].d
+
+/* every combination of argument types for the three slots */
+#define CALL(F) \
+    switch (type[0] * 9 + type[1] * 3 + type[2]) { \
+    case  0: r = F(buf, len, fmt, I(0), I(1), I(2)); break; \
+    case  1: r = F(buf, len, fmt, I(0), I(1), S(2)); break; \
+    case  2: r = F(buf, len, fmt, I(0), I(1), D(2)); break; \
+    case  3: r = F(buf, len, fmt, I(0), S(1), I(2)); break; \
+    case  4: r = F(buf, len, fmt, I(0), S(1), S(2)); break; \
+    case  5: r = F(buf, len, fmt, I(0), S(1), D(2)); break; \
+    case  6: r = F(buf, len, fmt, I(0), D(1), I(2)); break; \
+    case  7: r = F(buf, len, fmt, I(0), D(1), S(2)); break; \
+    case  8: r = F(buf, len, fmt, I(0), D(1), D(2)); break; \
+    case  9: r = F(buf, len, fmt, S(0), I(1), I(2)); break; \
+    case 10: r = F(buf, len, fmt, S(0), I(1), S(2)); break; \
+    case 11: r = F(buf, len, fmt, S(0), I(1), D(2)); break; \
+    case 12: r = F(buf, len, fmt, S(0), S(1), I(2)); break; \
+    case 13: r = F(buf, len, fmt, S(0), S(1), S(2)); break; \
+    case 14: r = F(buf, len, fmt, S(0), S(1), D(2)); break; \
+    case 15: r = F(buf, len, fmt, S(0), D(1), I(2)); break; \
+    case 16: r = F(buf, len, fmt, S(0), D(1), S(2)); break; \
+    case 17: r = F(buf, len, fmt, S(0), D(1), D(2)); break; \
+    case 18: r = F(buf, len, fmt, D(0), I(1), I(2)); break; \
+    case 19: r = F(buf, len, fmt, D(0), I(1), S(2)); break; \
+    case 20: r = F(buf, len, fmt, D(0), I(1), D(2)); break; \
+    case 21: r = F(buf, len, fmt, D(0), S(1), I(2)); break; \
+    case 22: r = F(buf, len, fmt, D(0), S(1), S(2)); break; \
+    case 23: r = F(buf, len, fmt, D(0), S(1), D(2)); break; \
+    case 24: r = F(buf, len, fmt, D(0), D(1), I(2)); break; \
+    case 25: r = F(buf, len, fmt, D(0), D(1), S(2)); break; \
+    case 26: r = F(buf, len, fmt, D(0), D(1), D(2)); break; \
+    }
+
+static int call_mini(char *buf, unsigned len, char *fmt, const int *type, const Arg *arg)
+{
+    int r = 0;
+#define F mini_snprintf
+    CALL(F)
+#undef F
+    return r;
+}
+
+static int call_libc(char *buf, unsigned len, char *fmt, const int *type, const Arg *arg)
+{
+    int r = 0;
+#define F snprintf
+    CALL(F)
+#undef F
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    long iters = argc > 1 ? atol(argv[1]) : 1000000, i, failures = 0;
+    unsigned long seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+    char fmt[128], want[BUF_MAX + 8], got[BUF_MAX + 8];
+    int type[MAX_CONV];
+    Arg arg[MAX_CONV];
+
+    rng_state = seed;
+    for (i = 0; i < iters; i++) {
+        unsigned len = rnd(BUF_MAX + 1);
+        int r_want, r_got;
+
+        rand_format(fmt, type, arg);
+        memset(want, '#', sizeof(want));
+        memset(got, '#', sizeof(got));
+        r_want = call_libc(want, len, fmt, type, arg);
+        r_got = call_mini(got, len, fmt, type, arg);
+        if (len == 0) r_want = 0;
+        else if (r_want > (int)len - 1) r_want = len - 1;
+
+        if (r_got != r_want || memcmp(want, got, sizeof(want))) {
+            if (failures++ < 20)
+                printf("len %2u fmt \"%s\": want %d \"%.*s\", got %d \"%.*s\"\n", len, fmt,
+                       r_want, len ? (int)len : 0, want, r_got, len ? (int)len : 0, got);
+        }
+    }
+    printf("%ld formats, seed %lu: %ld mismatches\n", iters, seed, failures);
+    return failures != 0;
+}
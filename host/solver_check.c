@@ -0,0 +1,60 @@
+/*
+ * Solver accuracy sweep, see solver_check.h
+ */
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "solver_check.h"
+
+const char *const OBJ_NAME[CHECK_NOBJ] = { "moon", "sun", "twilight" };
+
+static const float lats[] = { -60, -45, -20, 0, 20, 33.9616, 45, 55, 60, 65 };
+static const float lons[] = { -120, 0, 83.4299, 150 };
+
+void check_compare(CheckDiff *c, float want, float got)
+{
+    double d;
+    if ((want == 99.0) != (got == 99.0)) { c->mismatch++; return; }
+    if (want == 99.0) return;
+    d = fabs(want - got) * 60.0;
+    if (d > c->maxd) c->maxd = d;
+    c->sumd += d;
+    c->n++;
+    c->hist[d <= 0.5 ? 0 : d <= 1 ? 1 : d <= 2 ? 2 : d <= 5 ? 3 : 4]++;
+}
+
+void check_sweep(check_pair pair, int obj, CheckDiff *c)
+{
+    int l, m, d;
+    memset(c, 0, sizeof(*c));
+    for (l = 0; l < (int)(sizeof(lats) / sizeof(lats[0])); l++)
+        for (m = 0; m < (int)(sizeof(lons) / sizeof(lons[0])); m++)
+            for (d = 0; d < CHECK_DAYS; d++) {
+                float want[2], got[2];
+                pair(d, lats[l], lons[m], obj, want, got);
+                check_compare(c, want[0], got[0]);
+                check_compare(c, want[1], got[1]);
+            }
+}
+
+void check_table(check_pair pair, int hist)
+{
+    CheckDiff c;
+    int obj;
+
+    if (hist)
+        printf("%-9s %8s %10s %10s %9s   |d| <=0.5 <=1 <=2 <=5 >5 min\n",
+               "object", "events", "max |d|", "mean |d|", "mismatch");
+    else
+        printf("%-9s %8s %12s %12s %9s\n", "object", "events", "max |d| min", "mean |d| min", "mismatch");
+    for (obj = 0; obj < CHECK_NOBJ; obj++) {
+        check_sweep(pair, obj, &c);
+        if (hist)
+            printf("%-9s %8d %10.3f %10.4f %9d   %8d %4d %4d %4d %3d\n", OBJ_NAME[obj], c.n, c.maxd,
+                   c.n ? c.sumd / c.n : 0, c.mismatch, c.hist[0], c.hist[1], c.hist[2], c.hist[3], c.hist[4]);
+        else
+            printf("%-9s %8d %12.3f %12.4f %9d\n", OBJ_NAME[obj], c.n, c.maxd,
+                   c.n ? c.sumd / c.n : 0, c.mismatch);
+    }
+    printf("\n");
+}
@@ -0,0 +1,40 @@
+/*
+ * The accuracy sweep shared by the checkers that hold one rise/set
+ * solver against another (interp_check, warm_check, fixed_check): a
+ * grid of latitudes and longitudes over the days of 2014, with the
+ * differences in minutes summed up per object.
+ */
+#ifndef SOLVER_CHECK_H
+#define SOLVER_CHECK_H
+
+#define CHECK_JD    2456659     /* 2014-01-01 */
+#define CHECK_DAYS  366
+#define CHECK_NOBJ  3
+
+extern const char *const OBJ_NAME[CHECK_NOBJ];
+
+/*
+ * One object at one place and day: the reference rise and set into
+ * want[], the solver under test's into got[].  Days come in order from
+ * 0 for each place, so a solver that carries state from the day before
+ * can start over at day 0.
+ */
+typedef void (*check_pair)(int day, float lat, float lon, int obj, float want[2], float got[2]);
+
+typedef struct {
+    int n;                  /* events both solvers found */
+    int mismatch;           /* events only one of them found */
+    double maxd, sumd;      /* |d| in minutes */
+    int hist[5];            /* |d| <= 0.5, 1, 2, 5 minutes, more */
+} CheckDiff;
+
+/* one event, 99 = none */
+void check_compare(CheckDiff *c, float want, float got);
+
+/* every place and day for obj */
+void check_sweep(check_pair pair, int obj, CheckDiff *c);
+
+/* sweep each object and print a row for it, with the |d| histogram if hist */
+void check_table(check_pair pair, int hist);
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * pbl_sqrt accuracy and latency against the old subtraction/bisection
+ * version, over the inputs sunmooncalc actually feeds it.
+ *
+ * sunmoon.c is built a second time with pbl_sqrt renamed to sqrt_probe
+ * (see Makefile) so every argument it passes can be recorded.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "pbl-math.h"
+#include "sunmoon.h"
+
+#define JD_2014 2456659
+#define MAXPROBE (1 << 20)
+
+static float probe[MAXPROBE];
+static int nprobe;
+
+float sqrt_probe(float n)
+{
+    if (nprobe < MAXPROBE) probe[nprobe++] = n;
+    return pbl_sqrt(n);
+}
+
+/* the previous pbl_sqrt: O(sqrt(n)) walk + 32 bisection steps */
+static float legacy_sqrt(float n)
+{
+    int i;
+    n -= 1;
+    float x = 2;
+    for (; n > 1; n -= 2 * x++ - 1);
+    n += (x - 1) * (x - 1);
+    for (i = 0; i < 32; i++) {
+        x += (x * x < n) ? (float) 1 / (1 << i) : (float) -1 / (1 << i);
+    }
+    return x;
+}
+
+static double b_new(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) s += pbl_sqrt(probe[i % nprobe]);
+    return s;
+}
+
+static double b_legacy(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) s += legacy_sqrt(probe[i % nprobe]);
+    return s;
+}
+
+static void error_report(const char *what, float (*f)(float), const float *in, int n)
+{
+    double maxrel = 0, sumrel = 0;
+    float worst = 0;
+    int i, cnt = 0;
+    for (i = 0; i < n; i++) {
+        double ref, rel;
+        if (in[i] <= 0) continue;
+        ref = sqrt((double)in[i]);
+        rel = fabs(f(in[i]) - ref) / ref;
+        sumrel += rel;
+        cnt++;
+        if (rel > maxrel) { maxrel = rel; worst = in[i]; }
+    }
+    printf("  %-8s max rel err %.3e (at %g), mean %.3e\n",
+           what, maxrel, worst, cnt ? sumrel / cnt : 0);
+}
+
+int main(void)
+{
+    static const float lats[] = { -66, -45, 0, 33.9616, 51.5, 60, 66, 70 };
+    static float sweep[4096];
+    float rise, set, lo = 1e30f, hi = 0;
+    int d, l, i, zeros = 0;
+    BenchCase cases[] = {
+        { "pbl_sqrt (new)",    b_new,    1000000 },
+        { "pbl_sqrt (legacy)", b_legacy,  100000 },
+    };
+
+    /* collect the arguments sunmooncalc produces over a year */
+    for (l = 0; l < (int)(sizeof(lats) / sizeof(lats[0])); l++)
+        for (d = 0; d < 366; d++) {
+            sunmooncalc(JD_2014 + d, -5.0, lats[l], 83.43, 1, &rise, &set);
+            sunmooncalc(JD_2014 + d, -5.0, lats[l], 83.43, 0, &rise, &set);
+        }
+    for (i = 0; i < nprobe; i++) {
+        if (probe[i] <= 0) { zeros++; continue; }
+        if (probe[i] < lo) lo = probe[i];
+        if (probe[i] > hi) hi = probe[i];
+    }
+    printf("sunmooncalc sqrt arguments: %d calls, range [%g, %g], %d <= 0\n",
+           nprobe, lo, hi, zeros);
+
+    /* log sweep of the same range, to catch anything the sample missed */
+    for (i = 0; i < 4096; i++)
+        sweep[i] = lo * pow(hi / lo, i / 4095.0);
+
+    printf("accuracy on sunmooncalc inputs:\n");
+    error_report("new", pbl_sqrt, probe, nprobe);
+    error_report("legacy", legacy_sqrt, probe, nprobe);
+    printf("accuracy on log sweep of that range:\n");
+    error_report("new", pbl_sqrt, sweep, 4096);
+    error_report("legacy", legacy_sqrt, sweep, 4096);
+    printf("\n");
+
+    return bench_main(cases, 2, 10, NULL, NULL);
+}
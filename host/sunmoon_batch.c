@@ -0,0 +1,61 @@
+/*
+ * sunmoon_batch: picks the widest kernel the CPU runs and finishes the
+ * places it leaves over with sunmooncalc.
+ */
+#include "sunmoon.h"
+#include "sunmoon_batch.h"
+
+static const char *const isa_names[BATCH_ISAS] = { "scalar", "sse2", "avx" };
+
+static int has_isa(BatchIsa isa)
+{
+    switch (isa) {
+    case BATCH_SCALAR:
+        return 1;
+#ifdef BATCH_SIMD
+    case BATCH_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case BATCH_AVX:
+        return __builtin_cpu_supports("avx");
+#endif
+    default:
+        return 0;
+    }
+}
+
+int sunmoon_batch_isa(BatchIsa isa, double jd, int iobj, int n, const float *tz, const float *lat,
+                      const float *lon, float *rise, float *set)
+{
+    int i = 0;
+
+    if (!has_isa(isa)) return 0;
+#ifdef BATCH_SIMD
+    if (isa == BATCH_AVX)
+        i = sunmoon_batch_avx(jd, iobj, n, tz, lat, lon, rise, set);
+    else if (isa == BATCH_SSE2)
+        i = sunmoon_batch_sse2(jd, iobj, n, tz, lat, lon, rise, set);
+#endif
+    for (; i < n; i++)
+        sunmooncalc(jd, tz[i], lat[i], lon[i], iobj, &rise[i], &set[i]);
+    return 1;
+}
+
+BatchIsa sunmoon_batch_best(void)
+{
+    int isa = BATCH_ISAS - 1;
+    while (!has_isa(isa)) isa--;
+    return isa;
+}
+
+void sunmoon_batch(double jd, int iobj, int n, const float *tz, const float *lat, const float *lon,
+                   float *rise, float *set)
+{
+    static int best = -1;
+    if (best < 0) best = sunmoon_batch_best();
+    sunmoon_batch_isa(best, jd, iobj, n, tz, lat, lon, rise, set);
+}
+
+const char *sunmoon_batch_name(BatchIsa isa)
+{
+    return isa >= 0 && isa < BATCH_ISAS ? isa_names[isa] : "?";
+}
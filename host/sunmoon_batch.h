@@ -0,0 +1,46 @@
+/*
+ * Rise/set for many places at once, for pre-rendering almanacs on the
+ * build host or a server.  Places come in SoA layout, one array each
+ * for zone, latitude and longitude, with the same conventions as
+ * sunmooncalc: tz hours east of UTC, lon positive west, times in local
+ * hours with 99.0 for no event that day.
+ *
+ * The SSE2 and AVX kernels (sunmoon_batch_simd.c) run sin_alt and the
+ * parabola root search of sunmoon.c for 2 or 4 places per instruction.
+ * The Sun or Moon position sin_alt needs is the same for every place
+ * in a zone, so it is worked out once per zone and hour, not per place.
+ * Every rounding of sunmoon.c and pbl-math.c is repeated, float ones
+ * included, so each place's result is bit-for-bit what sunmooncalc
+ * returns for it (host/batch_check verifies this).  They are x86-64
+ * only; elsewhere, and for the last n % lanes places, the scalar
+ * fallback calls sunmooncalc.
+ */
+#ifndef SUNMOON_BATCH_H
+#define SUNMOON_BATCH_H
+
+typedef enum {
+    BATCH_SCALAR,
+    BATCH_SSE2,
+    BATCH_AVX,
+    BATCH_ISAS
+} BatchIsa;
+
+/* one day and object (0 = moon, 1 = sun, 2 = twilight) for n places */
+void sunmoon_batch(double jd, int iobj, int n, const float *tz, const float *lat, const float *lon,
+                   float *rise, float *set);
+
+/* the same on one instruction set; false if this CPU or build lacks it */
+int sunmoon_batch_isa(BatchIsa isa, double jd, int iobj, int n, const float *tz, const float *lat,
+                      const float *lon, float *rise, float *set);
+
+/* what sunmoon_batch uses, and the names for reports */
+BatchIsa sunmoon_batch_best(void);
+const char *sunmoon_batch_name(BatchIsa isa);
+
+/* kernels: the first n - n % lanes places, the rest is the caller's */
+int sunmoon_batch_sse2(double jd, int iobj, int n, const float *tz, const float *lat,
+                       const float *lon, float *rise, float *set);
+int sunmoon_batch_avx(double jd, int iobj, int n, const float *tz, const float *lat,
+                      const float *lon, float *rise, float *set);
+
+#endif // SUNMOON_BATCH_H
@@ -0,0 +1,467 @@
+/*
+ * The vector kernels of sunmoon_batch (sunmoon_batch.h).  This file is
+ * built twice, with -msse2 into sunmoon_batch_sse2 (2 places per vector)
+ * and with -mavx into sunmoon_batch_avx (4 places).
+ *
+ * The functions below are those of the same name in sunmoon.c and
+ * pbl-math.c, lane-wise and branch-free: both sides of a branch are
+ * computed and blended.  pbl-math works in float, so wherever the
+ * scalar code rounds to float (a float argument or variable, a float
+ * times float or an int times float product) the lanes are rounded to
+ * float too with F().  A float operation done in double and then
+ * rounded gives the float result exactly, so the lanes stay bit-for-bit
+ * with the scalar code as long as neither side is built with FMA
+ * contraction or -ffast-math.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sunmoon_batch.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+
+#define LANES        4
+#define BATCH_KERNEL sunmoon_batch_avx
+
+typedef __m256d vd;
+
+#define vset          _mm256_set1_pd
+#define vadd          _mm256_add_pd
+#define vsub          _mm256_sub_pd
+#define vmul          _mm256_mul_pd
+#define vdiv          _mm256_div_pd
+#define vand          _mm256_and_pd
+#define vor           _mm256_or_pd
+#define vxor          _mm256_xor_pd
+#define vandnot       _mm256_andnot_pd
+#define vlt(a, b)     _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define vle(a, b)     _mm256_cmp_pd(a, b, _CMP_LE_OQ)
+#define vgt(a, b)     _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define vge(a, b)     _mm256_cmp_pd(a, b, _CMP_GE_OQ)
+#define vsel(m, a, b) _mm256_blendv_pd(b, a, m)
+#define vmask(m)      _mm256_movemask_pd(m)
+#define ALL_LANES     0xf
+/* to and from float and int32 lanes, four in an __m128 / __m128i */
+#define vtof          _mm256_cvtpd_ps
+#define vfromf        _mm256_cvtps_pd
+#define vtoi          _mm256_cvttpd_epi32
+#define vfromi        _mm256_cvtepi32_pd
+#define vload(p)      _mm256_cvtps_pd(_mm_loadu_ps(p))
+#define vstore(p, a)  _mm_storeu_ps(p, _mm256_cvtpd_ps(a))
+#define vstorepd      _mm256_storeu_pd
+#define vgather(a, i) _mm256_set_pd((a)[(i)[3]], (a)[(i)[2]], (a)[(i)[1]], (a)[(i)[0]])
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+#define LANES        2
+#define BATCH_KERNEL sunmoon_batch_sse2
+
+typedef __m128d vd;
+
+#define vset          _mm_set1_pd
+#define vadd          _mm_add_pd
+#define vsub          _mm_sub_pd
+#define vmul          _mm_mul_pd
+#define vdiv          _mm_div_pd
+#define vand          _mm_and_pd
+#define vor           _mm_or_pd
+#define vxor          _mm_xor_pd
+#define vandnot       _mm_andnot_pd
+#define vlt           _mm_cmplt_pd
+#define vle           _mm_cmple_pd
+#define vgt           _mm_cmpgt_pd
+#define vge           _mm_cmpge_pd
+#define vsel(m, a, b) _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b))
+#define vmask(m)      _mm_movemask_pd(m)
+#define ALL_LANES     0x3
+/* two float and int32 lanes, the low half of an __m128 / __m128i */
+#define vtof          _mm_cvtpd_ps
+#define vfromf        _mm_cvtps_pd
+#define vtoi          _mm_cvttpd_epi32
+#define vfromi        _mm_cvtepi32_pd
+#define vload(p)      _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)(p))))
+#define vstore(p, a)  _mm_storel_epi64((__m128i *)(p), _mm_castps_si128(_mm_cvtpd_ps(a)))
+#define vstorepd      _mm_storeu_pd
+#define vgather(a, i) _mm_set_pd((a)[(i)[1]], (a)[(i)[0]])
+
+#endif
+
+#ifdef LANES
+
+#define PI 3.141592653589793    /* M_PI as pbl-math.h has it */
+
+#define C(x) vset(x)
+
+/* round to float, as assigning to or passing a float does */
+static inline vd F(vd x)
+{
+    return vfromf(vtof(x));
+}
+
+/* (int)x, back in a double */
+static inline vd trunc_int(vd x)
+{
+    return vfromi(vtoi(x));
+}
+
+static inline vd neg(vd x)
+{
+    return vxor(x, C(-0.0));
+}
+
+/* x < 0 ? -x : x, keeping -0 as dabs and pbl_fabs do */
+static inline vd vabs(vd x)
+{
+    return vsel(vlt(x, C(0)), neg(x), x);
+}
+
+/* lanes whose int32 (int)q has bit set */
+static inline vd bit_set(__m128i q, int bit)
+{
+    return vgt(vfromi(_mm_and_si128(q, _mm_set1_epi32(bit))), C(0));
+}
+
+/*----------------------------- pbl-math.c ------------------------------*/
+
+static inline vd pbl_sqrt(vd n)
+{
+    __m128i i = _mm_castps_si128(vtof(n));
+    vd h = F(vmul(C(0.5), n)), y;
+    int k;
+
+    i = _mm_sub_epi32(_mm_set1_epi32(0x5f3759df), _mm_srai_epi32(i, 1));
+    y = vfromf(_mm_castsi128_ps(i));
+    for (k = 0; k < 3; k++)
+        y = F(vmul(y, F(vsub(C(1.5), F(vmul(F(vmul(h, y)), y))))));
+    return vsel(vle(n, C(0)), C(0), F(vmul(n, y)));
+}
+
+static inline vd pbl_rint(vd x)
+{
+    vd t = trunc_int(F(vadd(vabs(x), C(0.5))));
+    return vsel(vlt(x, C(0)), neg(t), t);
+}
+
+static inline vd cos_core(vd x)
+{
+    vd x2 = F(vmul(x, x)), x4 = F(vmul(x2, x2)), x8 = F(vmul(x4, x4));
+    return F(vadd(vadd(vmul(vadd(vmul(C(-2.7236370439787708e-7), x2), C(2.4799852696610628e-5)), x8),
+                       vmul(vadd(vmul(C(-1.3888885054799695e-3), x2), C(4.1666666636943683e-2)), x4)),
+                  vadd(vmul(C(-4.9999999999963024e-1), x2), C(1.0000000000000000e+0))));
+}
+
+static inline vd sin_core(vd x)
+{
+    vd x2 = F(vmul(x, x)), x4 = F(vmul(x2, x2));
+    vd p = vadd(vmul(vsub(vmul(C(2.7181216275479732e-6), x2), C(1.9839312269456257e-4)), x4),
+                vsub(vmul(C(8.3333293048425631e-3), x2), C(1.6666666640797048e-1)));
+    return F(vadd(vmul(vmul(p, x2), x), x));
+}
+
+static inline vd pbl_sin(vd x)
+{
+    vd q = pbl_rint(F(vmul(x, C(6.3661977236758138e-1))));
+    __m128i quadrant = vtoi(q);
+    vd t = F(vsub(x, vmul(q, C(1.5707963267923333e+00))));
+    t = F(vsub(t, vmul(q, C(2.5633441515945189e-12))));
+    t = vsel(bit_set(quadrant, 1), cos_core(t), sin_core(t));
+    return vsel(bit_set(quadrant, 2), neg(t), t);
+}
+
+static inline vd pbl_cos(vd x)
+{
+    return pbl_sin(F(vadd(x, C(PI/2))));
+}
+
+/* pbl_atan(x) for x > 0, -pbl_atan(-x) otherwise */
+static inline vd pbl_atan(vd x)
+{
+    vd a = vabs(x), a2 = F(vmul(a, a)), a3 = F(vmul(a2, a));
+    vd num = vadd(vadd(vmul(C(0.640388203), a), a2), a3);
+    vd den = vadd(vadd(vadd(C(1), vmul(C(1.640388203), a)), vmul(vmul(C(1.640388203), a), a)), a3);
+    vd r = F(vdiv(vmul(C(PI/2), num), den));
+    return vsel(vgt(x, C(0)), r, neg(r));
+}
+
+/*------------------------------ sunmoon.c ------------------------------*/
+
+static inline vd frac(vd x)
+{
+    x = vsub(x, trunc_int(x));
+    return vsel(vlt(x, C(0)), vadd(x, C(1)), x);
+}
+
+/* degrees; rad expands to M_PI/180, so x*rad is (x*M_PI)/180 */
+static inline vd sn(vd x)
+{
+    return pbl_sin(F(vdiv(vmul(x, C(PI)), C(180))));
+}
+
+static inline vd cs(vd x)
+{
+    return pbl_cos(F(vdiv(vmul(x, C(PI)), C(180))));
+}
+
+/* lmst up to where the place comes in: lmst = 24*frac((gmst - lambda/15)/24) */
+static inline vd gmst(vd mjd)
+{
+    vd mjd0 = trunc_int(mjd);
+    vd ut = vmul(vsub(mjd, mjd0), C(24));
+    vd t = vdiv(vsub(mjd0, C(51544.5)), C(36525.0));
+    return vadd(vadd(C(6.697374558), vmul(C(1.0027379093), ut)),
+                vdiv(vmul(vadd(C(8640184.812866), vmul(vsub(C(0.093104), vmul(C(6.2E-6), t)), t)), t),
+                     C(3600.0)));
+}
+
+/* one pbl_atan, of the argument each lane's branch takes */
+static inline vd ra_half(vd x, vd y, vd rho)
+{
+    vd right = vge(x, C(0));
+    vd a = pbl_atan(F(vsel(right, vdiv(y, vadd(x, rho)), vdiv(y, vsub(rho, x)))));
+    return vsel(right, a, vsub(vsel(vge(y, C(0)), C(PI/2), C(-PI/2)), a));
+}
+
+/* RA (h) and Dec (deg) from the equatorial unit vector, as both minis end */
+static inline void equatorial(vd x, vd y, vd z, vd *ra, vd *dec)
+{
+    const double p2 = 6.283185307;
+    vd rho = pbl_sqrt(F(vsub(C(1.0), vmul(z, z))));
+    *dec = vmul(C(360.0/p2), pbl_atan(F(vdiv(z, rho))));
+    *ra = vmul(C(48.0/p2), ra_half(x, y, rho));
+    *ra = vsel(vlt(*ra, C(0)), vadd(*ra, C(24.0)), *ra);
+}
+
+/* k*pbl_sin(x) for an int k: a float product */
+static inline vd ksin(double k, vd x)
+{
+    return F(vmul(C(k), pbl_sin(F(x))));
+}
+
+static inline void mini_moon(vd t, vd *ra, vd *dec)
+{
+    const double p2 = 6.283185307;
+    const double arc = 206264.8062;
+    const double coseps = 0.91748;
+    const double sineps = 0.39778;
+    vd l0, l, ls, f, d, h, s, n, dl, cb, l_moon, b_moon, v, w, x, y, z;
+    vd d2, l2;
+
+    l0 =           frac(vadd(C(0.606433), vmul(C(1336.855225), t)));
+    l  = vmul(C(p2), frac(vadd(C(0.374897), vmul(C(1325.552410), t))));
+    ls = vmul(C(p2), frac(vadd(C(0.993133), vmul(C(  99.997361), t))));
+    d  = vmul(C(p2), frac(vadd(C(0.827361), vmul(C(1236.853086), t))));
+    f  = vmul(C(p2), frac(vadd(C(0.259086), vmul(C(1342.227825), t))));
+    d2 = vmul(C(2), d);
+    l2 = vmul(C(2), l);
+    /* a float sum, term by term */
+    dl = ksin(22640, l);
+    dl = F(vsub(dl, ksin(4586, vsub(l, d2))));
+    dl = F(vadd(dl, ksin(2370, d2)));
+    dl = F(vadd(dl, ksin(769, l2)));
+    dl = F(vsub(dl, ksin(668, ls)));
+    dl = F(vsub(dl, ksin(412, vmul(C(2), f))));
+    dl = F(vsub(dl, ksin(212, vsub(l2, d2))));
+    dl = F(vsub(dl, ksin(206, vsub(vadd(l, ls), d2))));
+    dl = F(vadd(dl, ksin(192, vadd(l, d2))));
+    dl = F(vsub(dl, ksin(165, vsub(ls, d2))));
+    dl = F(vsub(dl, ksin(125, d)));
+    dl = F(vsub(dl, ksin(110, vadd(l, ls))));
+    dl = F(vadd(dl, ksin(148, vsub(l, ls))));
+    dl = F(vsub(dl, ksin(55, vsub(vmul(C(2), f), d2))));
+    s = vadd(f, vdiv(vadd(vadd(dl, ksin(412, vmul(C(2), f))), ksin(541, ls)), C(arc)));
+    h = vsub(f, d2);
+    n = ksin(-526, h);
+    n = F(vadd(n, ksin(44, vadd(l, h))));
+    n = F(vsub(n, ksin(31, vadd(neg(l), h))));
+    n = F(vsub(n, ksin(23, vadd(ls, h))));
+    n = F(vadd(n, ksin(11, vadd(neg(ls), h))));
+    n = F(vsub(n, ksin(25, vadd(vmul(C(-2), l), f))));
+    n = F(vadd(n, ksin(21, vadd(neg(l), f))));
+    l_moon = vmul(C(p2), frac(vadd(l0, vdiv(dl, C(1296E3)))));
+    b_moon = vdiv(vadd(vmul(C(18520.0), pbl_sin(F(s))), n), C(arc));
+    cb = pbl_cos(F(b_moon));
+    x = vmul(cb, pbl_cos(F(l_moon)));
+    v = vmul(cb, pbl_sin(F(l_moon)));
+    w = pbl_sin(F(b_moon));
+    y = vsub(vmul(C(coseps), v), vmul(C(sineps), w));
+    z = vadd(vmul(C(sineps), v), vmul(C(coseps), w));
+    equatorial(x, y, z, ra, dec);
+}
+
+static inline void mini_sun(vd t, vd *ra, vd *dec)
+{
+    const double p2 = 6.283185307;
+    const double coseps = 0.91748;
+    const double sineps = 0.39778;
+    vd m, dl, l, sl;
+
+    m  = vmul(C(p2), frac(vadd(C(0.993133), vmul(C(99.997361), t))));
+    dl = vadd(vmul(C(6893.0), pbl_sin(F(m))), vmul(C(72.0), pbl_sin(F(vmul(C(2), m)))));
+    l  = vmul(C(p2), frac(vadd(vadd(C(0.7859453), vdiv(m, C(p2))),
+                               vdiv(vadd(vmul(C(6191.2), t), dl), C(1296E3)))));
+    sl = pbl_sin(F(l));
+    equatorial(pbl_cos(F(l)), vmul(C(coseps), sl), vmul(C(sineps), sl), ra, dec);
+}
+
+/*
+ * sin_alt splits into a part that depends only on the moment, which
+ * for a given day is the same for every place in a zone (the minis,
+ * GMST and sn/cs of the declination), and the place's own part: LMST
+ * from its longitude, the hour angle and one cosine.  The first is
+ * worked out once per zone and hour, vectorized across zones; the
+ * search runs vectorized across places on top of it.
+ */
+#define HOURS 25    /* 0h to 24h */
+
+typedef struct {
+    int count, stride;          /* zones, and count rounded up to LANES */
+    float *tz;                  /* stride */
+    double *gmst, *ra, *sdec, *cdec;    /* [hour * stride + zone] */
+} Zones;
+
+static void zone_ephemeris(Zones *z, double jd, int iobj)
+{
+    int k, h;
+    for (k = 0; k < z->stride; k += LANES) {
+        vd date = vsub(C((long)(jd-2400000.5)), vdiv(vload(z->tz + k), C(24.0)));
+        for (h = 0; h < HOURS; h++) {
+            vd mjd = vadd(date, C(h/24.0));
+            vd t = vdiv(vsub(mjd, C(51544.5)), C(36525.0));
+            vd ra, dec;
+            int at = h * z->stride + k;
+            if (iobj == 0)
+                mini_moon(t, &ra, &dec);
+            else
+                mini_sun(t, &ra, &dec);
+            vstorepd(z->gmst + at, gmst(mjd));
+            vstorepd(z->ra + at, ra);
+            vstorepd(z->sdec + at, sn(dec));
+            vstorepd(z->cdec + at, cs(dec));
+        }
+    }
+}
+
+/* sin_alt - sin(h0) for LANES places at a whole hour */
+static inline vd altitude(const Zones *z, const int *zone, int h, vd lam15, vd cphi, vd sphi, vd sinh0)
+{
+    const int at = h * z->stride;
+    vd lmst = vmul(C(24.0), frac(vdiv(vsub(vgather(z->gmst + at, zone), lam15), C(24.0))));
+    vd tau = vmul(C(15.0), vsub(lmst, vgather(z->ra + at, zone)));
+    vd sdec = vgather(z->sdec + at, zone), cdec = vgather(z->cdec + at, zone);
+    return vsub(vadd(vmul(sphi, sdec), vmul(vmul(cphi, cdec), cs(tau))), sinh0);
+}
+
+/* rise_set_search without the interpolated ephemeris, for LANES places */
+static void rise_set_search(const Zones *z, const int *zone, const float *lat, const float *lon,
+                            vd sinh0, float *utrise, float *utset)
+{
+    vd lam15 = vdiv(vload(lon), C(15.0)), phi = vload(lat);
+    vd sphi = sn(phi), cphi = cs(phi);
+    vd rise = C(99.0), set = C(99.0);
+    vd rose = C(0), sett = C(0);        /* lane masks */
+    vd y_minus = altitude(z, zone, 0, lam15, cphi, sphi, sinh0);
+    int hour;
+
+    /* [0h-2h] to [22h-24h], until every lane has both events */
+    for (hour = 1; hour < HOURS && vmask(vand(rose, sett)) != ALL_LANES; hour += 2) {
+        vd active = vandnot(vand(rose, sett), vle(C(0), C(0)));     /* not both yet */
+        vd y_0 = altitude(z, zone, hour, lam15, cphi, sphi, sinh0);
+        vd y_plus = altitude(z, zone, hour + 1, lam15, cphi, sphi, sinh0);
+        /* quad */
+        vd a = vsub(vmul(C(0.5), vadd(y_minus, y_plus)), y_0);
+        vd b = vmul(C(0.5), vsub(y_plus, y_minus));
+        vd xe = vdiv(neg(b), vmul(C(2.0), a));
+        vd ye = vadd(vmul(vadd(vmul(a, xe), b), xe), y_0);
+        vd dis = vsub(vmul(b, b), vmul(vmul(C(4.0), a), y_0));
+        vd real = vge(dis, C(0));
+        vd dx = vdiv(vmul(C(0.5), pbl_sqrt(F(dis))), vabs(a));
+        vd zero1 = vsub(xe, dx), zero2 = vadd(xe, dx);
+        vd in1 = vand(real, vle(vabs(zero1), C(1.0)));
+        vd in2 = vand(real, vle(vabs(zero2), C(1.0)));
+        vd one = vand(active, vxor(in1, in2));
+        vd two = vand(active, vand(in1, in2));
+        vd up = vlt(y_minus, C(0.0));
+        vd r1 = vand(one, up), s1 = vandnot(up, one);
+
+        zero1 = vsel(vand(real, vlt(zero1, C(-1.0))), zero2, zero1);
+        rise = vsel(r1, vadd(C(hour), zero1), rise);
+        set = vsel(s1, vadd(C(hour), zero1), set);
+        up = vlt(ye, C(0.0));
+        rise = vsel(two, vadd(C(hour), vsel(up, zero2, zero1)), rise);
+        set = vsel(two, vadd(C(hour), vsel(up, zero1, zero2)), set);
+        rose = vor(rose, vor(r1, two));
+        sett = vor(sett, vor(s1, two));
+        y_minus = y_plus;
+    }
+    vstore(utrise, rise);
+    vstore(utset, set);
+}
+
+/* the distinct zones of the places, and each place's index among them */
+static int find_zones(Zones *z, int n, const float *tz, int *zone)
+{
+    int size = 16, i, k;
+    int *slot;
+    double *block;
+
+    while (size < 2 * n) size *= 2;
+    slot = malloc(size * sizeof(int));
+    z->tz = malloc((n + LANES) * sizeof(float));
+    if (!slot || !z->tz) {
+        free(slot);
+        return 0;
+    }
+    memset(slot, -1, size * sizeof(int));
+    z->count = 0;
+    for (i = 0; i < n; i++) {
+        uint32_t bits;
+        memcpy(&bits, &tz[i], sizeof(bits));
+        for (k = (bits * 2654435761u) & (size - 1); slot[k] >= 0; k = (k + 1) & (size - 1))
+            if (memcmp(&z->tz[slot[k]], &tz[i], sizeof(float)) == 0) break;
+        if (slot[k] < 0) {
+            slot[k] = z->count;
+            z->tz[z->count++] = tz[i];
+        }
+        zone[i] = slot[k];
+    }
+    free(slot);
+    z->stride = (z->count + LANES - 1) / LANES * LANES;
+    for (k = z->count; k < z->stride; k++) z->tz[k] = z->tz[0];
+    block = malloc(4 * HOURS * z->stride * sizeof(double));
+    if (!block) {
+        free(z->tz);
+        return 0;
+    }
+    z->gmst = block;
+    z->ra = block + HOURS * z->stride;
+    z->sdec = block + 2 * HOURS * z->stride;
+    z->cdec = block + 3 * HOURS * z->stride;
+    return 1;
+}
+
+int BATCH_KERNEL(double jd, int iobj, int n, const float *tz, const float *lat, const float *lon,
+                 float *rise, float *set)
+{
+    static const double h0[] = { +8.0/60.0, -50.0/60.0, -6.0 };
+    vd sinh0 = sn(C(h0[iobj]));
+    int *zone = malloc((n + 1) * sizeof(int));
+    Zones z;
+    int i;
+
+    if (!zone) return 0;
+    if (!find_zones(&z, n, tz, zone)) {
+        free(zone);
+        return 0;
+    }
+    zone_ephemeris(&z, jd, iobj);
+    for (i = 0; i + LANES <= n; i += LANES)
+        rise_set_search(&z, zone + i, lat + i, lon + i, sinh0, rise + i, set + i);
+    free(z.gmst);
+    free(z.tz);
+    free(zone);
+    return i;
+}
+
+#endif // LANES
@@ -0,0 +1,360 @@
+/*
+ * Accuracy and speed regression suite for the rise/set solvers: every
+ * variant in sunmoon.h against the high-precision reference in
+ * sunmoon_ref.c, over a latitude/longitude grid (polar latitudes
+ * included, where there are days without an event) and several years.
+ *
+ *   ./sunmoon_check [-y year,year,...] [-s day_step] [-o save.txt] [-b baseline.txt]
+ *
+ * For each solver and object it reports the rise/set error in minutes
+ * (mean, median, 95th and 99th percentile, max), the events it misses
+ * or invents against the reference, and the time per call.  A second
+ * table breaks sunmooncalc's errors down by latitude.
+ *
+ * -o saves the summary; -b compares against a saved one and exits 1 if
+ * a solver got worse: 95th percentile up by more than 0.05 min, max up
+ * by more than 0.5 min, or more missed/invented events.  Times are
+ * shown against the baseline but never fail the check.
+ *
+ * The place's zone is its longitude rounded to whole hours, so the
+ * local day is the civil one; longitude is positive west, as in
+ * sunmooncalc.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "sunmoon.h"
+#include "sunmoon_ref.h"
+
+#define MAX_YEARS 8
+#define NOBJ      3
+
+static const char *OBJ_NAME[NOBJ] = { "moon", "sun", "twilight" };
+
+static const float lats[] = { -80, -70, -65, -60, -50, -40, -30, -20, -10, 0,
+                              10, 20, 30, 33.9616, 40, 50, 60, 65, 70, 80 };
+static const float lons[] = { -165, -120, -83.4299, -60, -30, 0, 30, 60, 90, 120, 150, 180 };
+#define NLAT (int)(sizeof(lats) / sizeof(lats[0]))
+#define NLON (int)(sizeof(lons) / sizeof(lons[0]))
+
+typedef struct {
+    float rise, set;
+} Event;
+
+/* one place's days, with the solver state carried from day to day */
+typedef struct {
+    const char *name;
+    void (*day)(int jd, float tz, float lat, float lon, int iobj, RiseSet *state, Event *ev);
+} Solver;
+
+static void s_full(int jd, float tz, float lat, float lon, int iobj, RiseSet *st, Event *ev)
+{
+    sunmooncalc(jd, tz, lat, lon, iobj, &ev->rise, &ev->set);
+}
+
+static void s_interp(int jd, float tz, float lat, float lon, int iobj, RiseSet *st, Event *ev)
+{
+    sunmooncalc_interp(jd, tz, lat, lon, iobj, &ev->rise, &ev->set);
+}
+
+static void s_fixed(int jd, float tz, float lat, float lon, int iobj, RiseSet *st, Event *ev)
+{
+    sunmooncalc_fixed(jd, tz, lat, lon, iobj, &ev->rise, &ev->set);
+}
+
+/* what the watch runs: cached per day, warm-started from the day before */
+static void s_update(int jd, float tz, float lat, float lon, int iobj, RiseSet *st, Event *ev)
+{
+    riseset_update(st, jd, tz, lat, lon, iobj);
+    ev->rise = st->rise;
+    ev->set = st->set;
+}
+
+static const Solver solvers[] = {
+    { "sunmooncalc",        s_full },
+    { "sunmooncalc_interp", s_interp },
+    { "riseset_update",     s_update },
+    { "sunmooncalc_fixed",  s_fixed },
+};
+#define NSOLVER (int)(sizeof(solvers) / sizeof(solvers[0]))
+
+typedef struct {
+    double *err;                /* |error| in minutes of matched events */
+    long n, cap;
+    long missed, extra;         /* event the reference has / has not */
+    long edge;                  /* one of the two is the next day's event */
+    long none;                  /* agreed there is no event (99.0) */
+    double ns;
+    long calls;
+} Errors;
+
+static int years[MAX_YEARS] = { 2000, 2013, 2026, 2039 };
+static int nyears = 4, day_step = 1;
+static int first_jd[MAX_YEARS], ndays[MAX_YEARS];
+
+/* reference events, [year][day][lat][lon][obj] */
+static Event *ref;
+
+static Event *ref_at(int y, int d, int l, int m, int o)
+{
+    long i = (((long)y * 366 + d) * NLAT + l) * NLON + m;
+    return &ref[i * NOBJ + o];
+}
+
+static float zone(int m)
+{
+    return floorf(lons[m] / 15 + 0.5f);
+}
+
+static void add_error(Errors *e, double d)
+{
+    if (e->n == e->cap) {
+        e->cap = e->cap ? 2 * e->cap : 4096;
+        e->err = realloc(e->err, e->cap * sizeof(double));
+    }
+    e->err[e->n++] = fabs(d);
+}
+
+static void compare(Errors *e, float got, float want)
+{
+    if ((got == 99.0f) != (want == 99.0f)) {
+        if (got == 99.0f) e->missed++;
+        else e->extra++;
+    } else if (got == 99.0f) {
+        e->none++;
+    } else {
+        double d = (got - want) * 60.0;
+        /*
+         * An event within seconds of midnight can land on either side of
+         * it; the other side then reports the following event, hours off.
+         */
+        if (fabs(d) > 60 && (got < 1 || got > 23 || want < 1 || want > 23)) e->edge++;
+        else add_error(e, d);
+    }
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+typedef struct {
+    double mean, p50, p95, p99, max;
+} Summary;
+
+static Summary summarize(Errors *e)
+{
+    Summary s = { 0, 0, 0, 0, 0 };
+    long i;
+    if (e->n == 0) return s;
+    qsort(e->err, e->n, sizeof(double), cmp_double);
+    for (i = 0; i < e->n; i++) s.mean += e->err[i];
+    s.mean /= e->n;
+    s.p50 = e->err[e->n / 2];
+    s.p95 = e->err[(long)(e->n * 0.95)];
+    s.p99 = e->err[(long)(e->n * 0.99)];
+    s.max = e->err[e->n - 1];
+    return s;
+}
+
+static void build_reference(void)
+{
+    int y, d, l, m, o;
+    ref = malloc(sizeof(Event) * NOBJ * (long)nyears * 366 * NLAT * NLON);
+    for (y = 0; y < nyears; y++) {
+        first_jd[y] = jdn(years[y], 1, 1);
+        ndays[y] = jdn(years[y] + 1, 1, 1) - first_jd[y];
+        ref_init(first_jd[y] - 1, first_jd[y] + ndays[y] + 1);
+        /* latitude innermost: the reference reuses a day's positions */
+        for (o = 0; o < NOBJ; o++)
+            for (m = 0; m < NLON; m++)
+                for (d = 0; d < ndays[y]; d += day_step)
+                    for (l = 0; l < NLAT; l++) {
+                        double r, s;
+                        ref_riseset(first_jd[y] + d, zone(m), lats[l], -lons[m], o, &r, &s);
+                        ref_at(y, d, l, m, o)->rise = r;
+                        ref_at(y, d, l, m, o)->set = s;
+                    }
+    }
+    ref_free();
+}
+
+/* run one solver over the grid; by_lat (may be NULL) gets errors per latitude */
+static void run_solver(const Solver *sv, int o, Errors *all, Errors *by_lat)
+{
+    int y, d, l, m;
+    for (y = 0; y < nyears; y++)
+        for (l = 0; l < NLAT; l++)
+            for (m = 0; m < NLON; m++) {
+                RiseSet state;
+                memset(&state, 0, sizeof(state));
+                for (d = 0; d < ndays[y]; d += day_step) {
+                    const Event *want = ref_at(y, d, l, m, o);
+                    Event got;
+                    double t0 = bench_now_ns();
+                    sv->day(first_jd[y] + d, zone(m), lats[l], -lons[m], o, &state, &got);
+                    all->ns += bench_now_ns() - t0;
+                    all->calls++;
+                    compare(all, got.rise, want->rise);
+                    compare(all, got.set, want->set);
+                    if (by_lat) {
+                        compare(&by_lat[l], got.rise, want->rise);
+                        compare(&by_lat[l], got.set, want->set);
+                    }
+                }
+            }
+}
+
+typedef struct {
+    char solver[32], obj[16];
+    Summary s;
+    long missed, extra, edge;
+    double ns;
+} Row;
+
+static Row rows[NSOLVER * NOBJ];
+
+static int load_baseline(const char *path, Row *base, int max)
+{
+    FILE *f = fopen(path, "r");
+    int n = 0;
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    while (n < max && fscanf(f, "%31s %15s %lf %lf %lf %lf %lf %ld %ld %ld %lf", base[n].solver, base[n].obj,
+                             &base[n].s.mean, &base[n].s.p50, &base[n].s.p95, &base[n].s.p99,
+                             &base[n].s.max, &base[n].missed, &base[n].extra, &base[n].edge,
+                             &base[n].ns) == 11)
+        n++;
+    fclose(f);
+    return n;
+}
+
+static int compare_baseline(const char *path)
+{
+    Row base[NSOLVER * NOBJ];
+    int nbase = load_baseline(path, base, NSOLVER * NOBJ), worse = 0, i, j;
+    if (nbase < 0) return 1;
+    printf("\nagainst %s:\n", path);
+    printf("%-20s %-9s %9s %9s %9s %9s\n", "solver", "object", "d p95", "d max", "d events", "time");
+    for (i = 0; i < NSOLVER * NOBJ; i++) {
+        const Row *r = &rows[i];
+        for (j = 0; j < nbase; j++)
+            if (!strcmp(base[j].solver, r->solver) && !strcmp(base[j].obj, r->obj)) break;
+        if (j == nbase) {
+            printf("%-20s %-9s %9s\n", r->solver, r->obj, "new");
+            continue;
+        }
+        {
+            double dp95 = r->s.p95 - base[j].s.p95, dmax = r->s.max - base[j].s.max;
+            long devents = (r->missed + r->extra) - (base[j].missed + base[j].extra);
+            int bad = dp95 > 0.05 || dmax > 0.5 || devents > 0;
+            printf("%-20s %-9s %+9.3f %+9.3f %+9ld %+8.1f%%%s\n", r->solver, r->obj, dp95, dmax, devents,
+                   base[j].ns > 0 ? 100.0 * (r->ns - base[j].ns) / base[j].ns : 0.0, bad ? "  WORSE" : "");
+            worse += bad;
+        }
+    }
+    return worse != 0;
+}
+
+static int parse_years(const char *arg)
+{
+    char *end;
+    nyears = 0;
+    while (*arg && nyears < MAX_YEARS) {
+        years[nyears++] = strtol(arg, &end, 10);
+        if (end == arg) return -1;
+        arg = *end == ',' ? end + 1 : end;
+    }
+    return nyears ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *save = NULL, *baseline = NULL;
+    Errors by_lat[NOBJ][NLAT];
+    int i, o, l, y;
+    double t0;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-y") && i + 1 < argc) {
+            if (parse_years(argv[++i])) {
+                fprintf(stderr, "bad year list %s\n", argv[i]);
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) day_step = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) save = argv[++i];
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) baseline = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [-y year,year,...] [-s day_step] [-o save.txt] [-b baseline.txt]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (day_step < 1) day_step = 1;
+
+    if (ref_selftest()) return 1;
+    t0 = bench_now_ns();
+    build_reference();
+    printf("%d latitudes x %d longitudes, years", NLAT, NLON);
+    for (y = 0; y < nyears; y++) printf(" %d", years[y]);
+    printf(", every %d day(s); reference built in %.1f s\n\n", day_step, (bench_now_ns() - t0) / 1e9);
+
+    memset(by_lat, 0, sizeof(by_lat));
+    printf("%-20s %-9s %8s %7s %7s %7s %7s %7s %6s %6s %5s %8s\n", "solver", "object", "events",
+           "mean", "p50", "p95", "p99", "max", "missed", "extra", "edge", "ns/call");
+    for (i = 0; i < NSOLVER; i++) {
+        for (o = 0; o < NOBJ; o++) {
+            Errors e;
+            Row *r = &rows[i * NOBJ + o];
+            memset(&e, 0, sizeof(e));
+            run_solver(&solvers[i], o, &e, i == 0 ? by_lat[o] : NULL);
+            snprintf(r->solver, sizeof(r->solver), "%s", solvers[i].name);
+            snprintf(r->obj, sizeof(r->obj), "%s", OBJ_NAME[o]);
+            r->s = summarize(&e);
+            r->missed = e.missed;
+            r->extra = e.extra;
+            r->edge = e.edge;
+            r->ns = e.ns / e.calls;
+            printf("%-20s %-9s %8ld %7.3f %7.3f %7.3f %7.3f %7.2f %6ld %6ld %5ld %8.0f\n", r->solver, r->obj,
+                   e.n, r->s.mean, r->s.p50, r->s.p95, r->s.p99, r->s.max, r->missed, r->extra, r->edge,
+                   r->ns);
+            free(e.err);
+        }
+    }
+    printf("(|error| in minutes against the reference; missed/extra = events only the reference/solver has;\n"
+           " edge = events either side of midnight, the other side reporting the next one)\n");
+
+    printf("\nsunmooncalc by latitude (none = rises/sets both agree are missing, differ = missed + extra + edge):\n%8s", "lat");
+    for (o = 0; o < NOBJ; o++) printf(" %8s p95 %7s %5s %6s", OBJ_NAME[o], "max", "none", "differ");
+    printf("\n");
+    for (l = 0; l < NLAT; l++) {
+        printf("%8.2f", lats[l]);
+        for (o = 0; o < NOBJ; o++) {
+            Errors *e = &by_lat[o][l];
+            Summary s = summarize(e);
+            printf(" %12.3f %7.2f %5ld %6ld", s.p95, s.max, e->none, e->missed + e->extra + e->edge);
+            free(e->err);
+        }
+        printf("\n");
+    }
+
+    if (save) {
+        FILE *f = fopen(save, "w");
+        if (!f) {
+            perror(save);
+            return 1;
+        }
+        for (i = 0; i < NSOLVER * NOBJ; i++)
+            fprintf(f, "%s %s %.4f %.4f %.4f %.4f %.4f %ld %ld %ld %.1f\n", rows[i].solver, rows[i].obj,
+                    rows[i].s.mean, rows[i].s.p50, rows[i].s.p95, rows[i].s.p99, rows[i].s.max,
+                    rows[i].missed, rows[i].extra, rows[i].edge, rows[i].ns);
+        fclose(f);
+    }
+    free(ref);
+    return baseline ? compare_baseline(baseline) : 0;
+}
@@ -0,0 +1,388 @@
+/*
+ * High-precision rise/set reference, see sunmoon_ref.h
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sunmoon_ref.h"
+
+#define D2R        (M_PI / 180.0)
+#define J2000      2451545.0
+#define EARTH_KM   6378.14
+#define STEP_MIN   10                   /* scan step for sign changes */
+#define NSAMPLE    (24 * 60 / STEP_MIN + 1)
+
+typedef struct {
+    double ra, dec, dist;
+} Pos;
+
+static double norm360(double x)
+{
+    x = fmod(x, 360.0);
+    return x < 0 ? x + 360.0 : x;
+}
+
+/* TT - UT in seconds (Espenak and Meeus) */
+static double delta_t(double jd)
+{
+    double y = 2000.0 + (jd - 2451544.5) / 365.25, t = y - 2000.0, u;
+    if (y < 2005)
+        return 63.86 + t * (0.3345 + t * (-0.060374 + t * (0.0017275 + t * (0.000651814 + t * 0.00002373599))));
+    if (y < 2050)
+        return 62.92 + t * (0.32217 + t * 0.005589);
+    u = (y - 1820) / 100;
+    return -20 + 32 * u * u - 0.5628 * (2150 - y);
+}
+
+/* nutation in longitude and obliquity, degrees (chapter 22, to 0.5") */
+static void nutation(double T, double *dpsi, double *deps)
+{
+    double om = (125.04452 - 1934.136261 * T) * D2R;
+    double ls = (280.4665 + 36000.7698 * T) * D2R;
+    double lm = (218.3165 + 481267.8813 * T) * D2R;
+    *dpsi = (-17.20 * sin(om) - 1.32 * sin(2 * ls) - 0.23 * sin(2 * lm) + 0.21 * sin(2 * om)) / 3600;
+    *deps = (9.20 * cos(om) + 0.57 * cos(2 * ls) + 0.10 * cos(2 * lm) - 0.09 * cos(2 * om)) / 3600;
+}
+
+static double mean_obliquity(double T)
+{
+    return 23.0 + 26.0 / 60 + (21.448 - T * (46.8150 + T * (0.00059 - T * 0.001813))) / 3600;
+}
+
+static void ecliptic_to_equatorial(double lambda, double beta, double eps, double *ra, double *dec)
+{
+    double l = lambda * D2R, b = beta * D2R, e = eps * D2R;
+    *ra = norm360(atan2(sin(l) * cos(e) - tan(b) * sin(e), cos(l)) / D2R);
+    *dec = asin(sin(b) * cos(e) + cos(b) * sin(e) * sin(l)) / D2R;
+}
+
+/* apparent geocentric Sun, T in Julian centuries TT (chapter 25) */
+static void sun_apparent(double T, double *ra, double *dec)
+{
+    double L0 = 280.46646 + T * (36000.76983 + T * 0.0003032);
+    double M = (357.52911 + T * (35999.05029 - T * 0.0001537)) * D2R;
+    double C = (1.914602 - T * (0.004817 + T * 0.000014)) * sin(M)
+             + (0.019993 - T * 0.000101) * sin(2 * M) + 0.000289 * sin(3 * M);
+    double om = (125.04 - 1934.136 * T) * D2R;
+    double lambda = L0 + C - 0.00569 - 0.00478 * sin(om);
+    double eps = mean_obliquity(T) + 0.00256 * cos(om);
+    ecliptic_to_equatorial(lambda, 0, eps, ra, dec);
+}
+
+/* periodic terms of the Moon's longitude/distance and latitude (tables 47.A, 47.B) */
+static const signed char moon_lr_args[60][4] = {
+    {0,0,1,0},{2,0,-1,0},{2,0,0,0},{0,0,2,0},{0,1,0,0},{0,0,0,2},{2,0,-2,0},{2,-1,-1,0},
+    {2,0,1,0},{2,-1,0,0},{0,1,-1,0},{1,0,0,0},{0,1,1,0},{2,0,0,-2},{0,0,1,2},{0,0,1,-2},
+    {4,0,-1,0},{0,0,3,0},{4,0,-2,0},{2,1,-1,0},{2,1,0,0},{1,0,-1,0},{1,1,0,0},{2,-1,1,0},
+    {2,0,2,0},{4,0,0,0},{2,0,-3,0},{0,1,-2,0},{2,0,-1,2},{2,-1,-2,0},{1,0,1,0},{2,-2,0,0},
+    {0,1,2,0},{0,2,0,0},{2,-2,-1,0},{2,0,1,-2},{2,0,0,2},{4,-1,-1,0},{0,0,2,2},{3,0,-1,0},
+    {2,1,1,0},{4,-1,-2,0},{0,2,-1,0},{2,2,-1,0},{2,1,-2,0},{2,-1,0,-2},{4,0,1,0},{0,0,4,0},
+    {4,-1,0,0},{1,0,-2,0},{2,1,0,-2},{0,0,2,-2},{1,1,1,0},{3,0,-2,0},{4,0,-3,0},{2,-1,2,0},
+    {0,2,1,0},{1,1,-1,0},{2,0,3,0},{2,0,-1,-2},
+};
+
+static const long moon_l_coef[60] = {
+    6288774, 1274027, 658314, 213618, -185116, -114332, 58793, 57066, 53322, 45758,
+    -40923, -34720, -30383, 15327, -12528, 10980, 10675, 10034, 8548, -7888,
+    -6766, -5163, 4987, 4036, 3994, 3861, 3665, -2689, -2602, 2390,
+    -2348, 2236, -2120, -2069, 2048, -1773, -1595, 1215, -1110, -892,
+    -810, 759, -713, -700, 691, 596, 549, 537, 520, -487,
+    -399, -381, 351, -340, 330, 327, -323, 299, 294, 0,
+};
+
+static const long moon_r_coef[60] = {
+    -20905355, -3699111, -2955968, -569925, 48888, -3149, 246158, -152138, -170733, -204586,
+    -129620, 108743, 104755, 10321, 0, 79661, -34782, -23210, -21636, 24208,
+    30824, -8379, -16675, -12831, -10445, -11650, 14403, -7003, 0, 10056,
+    6322, -9884, 5751, 0, -4950, 4130, 0, -3958, 0, 3258,
+    2616, -1897, -2117, 2354, 0, 0, -1423, -1117, -1571, -1739,
+    0, -4421, 0, 0, 0, 0, 1165, 0, 0, 8752,
+};
+
+static const signed char moon_b_args[60][4] = {
+    {0,0,0,1},{0,0,1,1},{0,0,1,-1},{2,0,0,-1},{2,0,-1,1},{2,0,-1,-1},{2,0,0,1},{0,0,2,1},
+    {2,0,1,-1},{0,0,2,-1},{2,-1,0,-1},{2,0,-2,-1},{2,0,1,1},{2,1,0,-1},{2,-1,-1,1},{2,-1,0,1},
+    {2,-1,-1,-1},{0,1,-1,-1},{4,0,-1,-1},{0,1,0,1},{0,0,0,3},{0,1,-1,1},{1,0,0,1},{0,1,1,1},
+    {0,1,1,-1},{0,1,0,-1},{1,0,0,-1},{0,0,3,1},{4,0,0,-1},{4,0,-1,1},{0,0,1,-3},{4,0,-2,1},
+    {2,0,0,-3},{2,0,2,-1},{2,-1,1,-1},{2,0,-2,1},{0,0,3,-1},{2,0,2,1},{2,0,-3,-1},{2,1,-1,1},
+    {2,1,0,1},{4,0,0,1},{2,-1,1,1},{2,-2,0,-1},{0,0,1,3},{2,1,1,-1},{1,1,0,-1},{1,1,0,1},
+    {0,1,-2,-1},{2,1,-1,-1},{1,0,1,1},{2,-1,-2,-1},{0,1,2,1},{4,0,-2,-1},{4,-1,-1,-1},{1,0,1,-1},
+    {4,0,1,-1},{1,0,-1,-1},{4,-1,0,-1},{2,-2,0,1},
+};
+
+static const long moon_b_coef[60] = {
+    5128122, 280602, 277693, 173237, 55413, 46271, 32573, 17198, 9266, 8822,
+    8216, 4324, 4200, -3359, 2463, 2211, 2065, -1870, 1828, -1794,
+    -1749, -1565, -1491, -1475, -1410, -1344, -1335, 1107, 1021, 833,
+    777, 671, 607, 596, 491, -451, 439, 422, 421, -366,
+    -351, 331, 315, 302, -283, -229, 223, 223, -220, -220,
+    -185, 181, -177, 176, 166, -164, 132, -119, 115, 107,
+};
+
+/* geometric ecliptic coordinates of the Moon, degrees and km (chapter 47) */
+static void moon_ecliptic(double T, double *lambda, double *beta, double *dist)
+{
+    double T2 = T * T, T3 = T2 * T, T4 = T3 * T;
+    double Lp = norm360(218.3164477 + 481267.88123421 * T - 0.0015786 * T2 + T3 / 538841 - T4 / 65194000);
+    double D = norm360(297.8501921 + 445267.1114034 * T - 0.0018819 * T2 + T3 / 545868 - T4 / 113065000);
+    double M = norm360(357.5291092 + 35999.0502909 * T - 0.0001536 * T2 + T3 / 24490000);
+    double Mp = norm360(134.9633964 + 477198.8675055 * T + 0.0087414 * T2 + T3 / 69699 - T4 / 14712000);
+    double F = norm360(93.2720950 + 483202.0175233 * T - 0.0036539 * T2 - T3 / 3526000 + T4 / 863310000);
+    double A1 = (119.75 + 131.849 * T) * D2R;
+    double A2 = (53.09 + 479264.290 * T) * D2R;
+    double A3 = (313.45 + 481266.484 * T) * D2R;
+    double E = 1 - 0.002516 * T - 0.0000074 * T2;
+    double sl = 0, sr = 0, sb = 0;
+    int i;
+
+    for (i = 0; i < 60; i++) {
+        const signed char *a = moon_lr_args[i];
+        double arg = (a[0] * D + a[1] * M + a[2] * Mp + a[3] * F) * D2R;
+        double e = a[1] == 0 ? 1 : (a[1] == 1 || a[1] == -1) ? E : E * E;
+        sl += moon_l_coef[i] * e * sin(arg);
+        sr += moon_r_coef[i] * e * cos(arg);
+    }
+    for (i = 0; i < 60; i++) {
+        const signed char *a = moon_b_args[i];
+        double arg = (a[0] * D + a[1] * M + a[2] * Mp + a[3] * F) * D2R;
+        double e = a[1] == 0 ? 1 : (a[1] == 1 || a[1] == -1) ? E : E * E;
+        sb += moon_b_coef[i] * e * sin(arg);
+    }
+    sl += 3958 * sin(A1) + 1962 * sin((Lp - F) * D2R) + 318 * sin(A2);
+    sb += -2235 * sin(Lp * D2R) + 382 * sin(A3) + 175 * sin(A1 - F * D2R) + 175 * sin(A1 + F * D2R)
+        + 127 * sin((Lp - Mp) * D2R) - 115 * sin((Lp + Mp) * D2R);
+
+    *lambda = norm360(Lp + sl / 1e6);
+    *beta = sb / 1e6;
+    *dist = 385000.56 + sr / 1000;
+}
+
+static void moon_apparent(double T, double *ra, double *dec, double *dist)
+{
+    double lambda, beta, dpsi, deps;
+    moon_ecliptic(T, &lambda, &beta, dist);
+    nutation(T, &dpsi, &deps);
+    ecliptic_to_equatorial(lambda + dpsi, beta, mean_obliquity(T) + deps, ra, dec);
+}
+
+/* mean sidereal time at Greenwich, degrees (chapter 12) */
+static double gmst(double jd)
+{
+    double T = (jd - J2000) / 36525;
+    return norm360(280.46061837 + 360.98564736629 * (jd - J2000) + T * T * (0.000387933 - T / 38710000));
+}
+
+/* equation of the equinoxes, degrees */
+static double eqeq(double T)
+{
+    double dpsi, deps;
+    nutation(T, &dpsi, &deps);
+    return dpsi * cos((mean_obliquity(T) + deps) * D2R);
+}
+
+static void position_direct(int iobj, double jd, Pos *p, double *eq)
+{
+    double T = (jd + delta_t(jd) / 86400 - J2000) / 36525;
+    if (iobj == 0) {
+        moon_apparent(T, &p->ra, &p->dec, &p->dist);
+    } else {
+        sun_apparent(T, &p->ra, &p->dec);
+        p->dist = 0;
+    }
+    if (eq) *eq = eqeq(T);
+}
+
+/* hourly table: moon, sun, equation of the equinoxes */
+static Pos *table[2];
+static double *eq_table;
+static double table_jd0;
+static int table_n;
+
+void ref_init(double jd_first, double jd_last)
+{
+    int i, k;
+    ref_free();
+    table_jd0 = floor(jd_first) - 2;
+    table_n = (int)((jd_last + 3 - table_jd0) * 24) + 1;
+    table[0] = malloc(table_n * sizeof(Pos));
+    table[1] = malloc(table_n * sizeof(Pos));
+    eq_table = malloc(table_n * sizeof(double));
+    for (i = 0; i < table_n; i++) {
+        double jd = table_jd0 + i / 24.0;
+        for (k = 0; k < 2; k++) {
+            position_direct(k, jd, &table[k][i], k ? NULL : &eq_table[i]);
+            /* keep RA continuous for the interpolation */
+            if (i > 0) {
+                while (table[k][i].ra - table[k][i - 1].ra > 180) table[k][i].ra -= 360;
+                while (table[k][i].ra - table[k][i - 1].ra < -180) table[k][i].ra += 360;
+            }
+        }
+    }
+}
+
+void ref_free(void)
+{
+    free(table[0]);
+    free(table[1]);
+    free(eq_table);
+    table[0] = table[1] = NULL;
+    eq_table = NULL;
+    table_n = 0;
+}
+
+/* position and equation of the equinoxes at jd, from the table if it covers it */
+static void position(int iobj, double jd, Pos *p, double *eq)
+{
+    double x = (jd - table_jd0) * 24, w[4], q;
+    int i, k, obj = iobj == 0 ? 0 : 1;
+
+    i = (int)floor(x) - 1;
+    if (table_n == 0 || i < 0 || i + 3 >= table_n) {
+        position_direct(obj, jd, p, eq);
+        return;
+    }
+    q = x - (i + 1);
+    w[0] = -q * (q - 1) * (q - 2) / 6;
+    w[1] = (q + 1) * (q - 1) * (q - 2) / 2;
+    w[2] = -(q + 1) * q * (q - 2) / 2;
+    w[3] = (q + 1) * q * (q - 1) / 6;
+    p->ra = p->dec = p->dist = 0;
+    *eq = 0;
+    for (k = 0; k < 4; k++) {
+        const Pos *t = &table[obj][i + k];
+        p->ra += w[k] * t->ra;
+        p->dec += w[k] * t->dec;
+        p->dist += w[k] * t->dist;
+        *eq += w[k] * eq_table[i + k];
+    }
+    p->ra = norm360(p->ra);
+}
+
+void ref_position(int iobj, double jd, double *ra, double *dec, double *dist)
+{
+    Pos p;
+    double eq;
+    position(iobj, jd, &p, &eq);
+    *ra = p.ra;
+    *dec = p.dec;
+    *dist = p.dist;
+}
+
+/* altitude of the event, degrees */
+static double event_altitude(int iobj, const Pos *p)
+{
+    if (iobj == 0) return 0.7275 * asin(EARTH_KM / p->dist) / D2R - 34.0 / 60;
+    if (iobj == 1) return -50.0 / 60;
+    return -6.0;
+}
+
+/* sin(altitude) - sin(event altitude) at jd for a place */
+static double above(int iobj, double jd, double lon, double sphi, double cphi)
+{
+    Pos p;
+    double eq, H;
+    position(iobj, jd, &p, &eq);
+    H = (gmst(jd) + eq - lon - p.ra) * D2R;
+    return sphi * sin(p.dec * D2R) + cphi * cos(p.dec * D2R) * cos(H) - sin(event_altitude(iobj, &p) * D2R);
+}
+
+/*
+ * The positions along one local day depend on the day, zone and
+ * longitude but not on the latitude; they are kept for the next call.
+ */
+static struct {
+    int valid, iobj;
+    double start, lon;
+    double sdec[NSAMPLE], cdec[NSAMPLE], cosH[NSAMPLE], sinh0[NSAMPLE];
+} day;
+
+static void day_samples(int iobj, double start, double lon)
+{
+    int i;
+    if (day.valid && day.iobj == iobj && day.start == start && day.lon == lon) return;
+    day.valid = 1;
+    day.iobj = iobj;
+    day.start = start;
+    day.lon = lon;
+    for (i = 0; i < NSAMPLE; i++) {
+        double jd = start + i * STEP_MIN / 1440.0, eq;
+        Pos p;
+        position(iobj, jd, &p, &eq);
+        day.sdec[i] = sin(p.dec * D2R);
+        day.cdec[i] = cos(p.dec * D2R);
+        day.cosH[i] = cos((gmst(jd) + eq - lon - p.ra) * D2R);
+        day.sinh0[i] = sin(event_altitude(iobj, &p) * D2R);
+    }
+}
+
+/* crossing in [a, b] (Julian days) by bisection, to a tenth of a second */
+static double bisect(int iobj, double a, double b, double fa, double lon, double sphi, double cphi)
+{
+    while (b - a > 0.1 / 86400) {
+        double m = 0.5 * (a + b), fm = above(iobj, m, lon, sphi, cphi);
+        if ((fm < 0) == (fa < 0)) {
+            a = m;
+            fa = fm;
+        } else {
+            b = m;
+        }
+    }
+    return 0.5 * (a + b);
+}
+
+void ref_riseset(double jd, double tz, double lat, double lon, int iobj, double *rise, double *set)
+{
+    double start = floor(jd) - 0.5 - tz / 24, sphi = sin(lat * D2R), cphi = cos(lat * D2R);
+    double prev = 0, f;
+    int i;
+
+    day_samples(iobj, start, lon);
+    *rise = *set = 99.0;
+    for (i = 0; i < NSAMPLE; i++) {
+        f = sphi * day.sdec[i] + cphi * day.cdec[i] * day.cosH[i] - day.sinh0[i];
+        if (i > 0 && (prev < 0) != (f < 0)) {
+            double a = start + (i - 1) * STEP_MIN / 1440.0;
+            double t = bisect(iobj, a, a + STEP_MIN / 1440.0, prev, lon, sphi, cphi);
+            double hour = (t - start) * 24;
+            if (prev < 0 && *rise == 99.0) *rise = hour;
+            if (prev >= 0 && *set == 99.0) *set = hour;
+        }
+        prev = f;
+    }
+}
+
+static int near(const char *what, double got, double want, double tol)
+{
+    if (fabs(got - want) <= tol) return 0;
+    printf("reference self-test: %s = %.6f, expected %.6f\n", what, got, want);
+    return 1;
+}
+
+int ref_selftest(void)
+{
+    double lambda, beta, dist, ra, dec, T, dpsi, deps;
+    int fail = 0;
+
+    /* example 47.a, 1992 April 12 0h TD */
+    T = (2448724.5 - J2000) / 36525;
+    moon_ecliptic(T, &lambda, &beta, &dist);
+    fail += near("47.a lambda", lambda, 133.162655, 1e-5);
+    fail += near("47.a beta", beta, -3.229126, 1e-5);
+    fail += near("47.a distance", dist, 368409.7, 0.1);
+    moon_apparent(T, &ra, &dec, &dist);
+    fail += near("47.a RA", ra, 134.688470, 3e-4);
+    fail += near("47.a Dec", dec, 13.768368, 3e-4);
+
+    /* example 25.a, 1992 October 13 0h TD */
+    T = (2448908.5 - J2000) / 36525;
+    sun_apparent(T, &ra, &dec);
+    fail += near("25.a RA", ra, 198.38083, 2e-4);
+    fail += near("25.a Dec", dec, -7.78507, 2e-4);
+
+    /* examples 12.a and 22.a */
+    fail += near("12.a mean sidereal time", gmst(2446895.5), 197.693195, 1e-6);
+    nutation((2446895.5 - J2000) / 36525, &dpsi, &deps);
+    fail += near("22.a nutation in longitude", dpsi * 3600, -3.788, 0.5);
+    fail += near("22.a nutation in obliquity", deps * 3600, 9.443, 0.1);
+    return fail;
+}
@@ -0,0 +1,37 @@
+/*
+ * High-precision reference for sunmooncalc, double precision with libm.
+ *
+ * Positions follow Meeus, Astronomical Algorithms (2nd ed.): the Sun
+ * from chapter 25 (about 0.01 deg), the Moon from the 60+60 term series
+ * of chapter 47 (about 10"), both apparent (nutation, aberration) and
+ * in the equinox of date; sidereal time from chapter 12 with the
+ * equation of the equinoxes; TT - UT from the Espenak-Meeus polynomial.
+ * Positions are tabulated hourly over the span given to ref_init and
+ * interpolated (4-point Lagrange) after that.
+ *
+ * Events use the almanac definitions: the Sun's centre at -50' (upper
+ * limb on the refracted horizon), civil twilight at -6 deg, and the
+ * Moon's upper limb on the horizon with its actual parallax,
+ * h0 = 0.7275 * parallax - 34' (sunmooncalc assumes a fixed +8').
+ */
+#ifndef SUNMOON_REF_H
+#define SUNMOON_REF_H
+
+/* tabulate positions for Julian days [jd_first, jd_last] */
+void ref_init(double jd_first, double jd_last);
+void ref_free(void);
+
+/* apparent RA, Dec (deg) and distance (km, Moon only) at jd (UT) */
+void ref_position(int iobj, double jd, double *ra, double *dec, double *dist);
+
+/*
+ * Same arguments and conventions as sunmooncalc: jd the day's Julian
+ * day number, tz hours east of UTC, lon positive west; the first rise
+ * and first set in the local day, in local hours, 99.0 = none.
+ */
+void ref_riseset(double jd, double tz, double lat, double lon, int iobj, double *rise, double *set);
+
+/* checks against the worked examples in Meeus; returns failures */
+int ref_selftest(void);
+
+#endif // SUNMOON_REF_H
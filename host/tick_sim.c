@@ -0,0 +1,448 @@
+/*
+ * Replays the watchface (src/main.c and the modules it uses, built
+ * against the host Pebble shim) second by second over simulated days
+ * or years, and reports the time spent per tick, the worst tick and
+ * how much UI work each kind of change causes.
+ *
+ *   ./tick_sim [-d days | -y years] [-s YYYY-MM-DD[THH:MM:SS]] [-24]
+ *              [-t tap_seconds] [-w weather_minutes] [-b battery_percent]
+ *              [-l lat,lon,utc_minutes] [-j minutes] [-r resources_dir] [-v]
+ *
+ * Defaults: 7 days from 2026-01-01, 12h clock, a wrist tap every hour,
+ * weather from the phone every 15 minutes (as pebble-js-app.js sends
+ * it) and 80% battery.  With -l each weather message also carries the
+ * phone's location, wandering a kilometre or two like a GPS fix, and
+ * the report says where the almanac found its days.  With -j the clock
+ * is set that many minutes forward (or back, if negative) halfway
+ * through, as an owner or the phone would.
+ *
+ * The tick service fires like the watch's: once per second the changed
+ * units are worked out and the handler runs if they include the
+ * subscribed unit.  Each event (tick, tap, message, timer) is timed
+ * together with the frame it causes.  Times are host nanoseconds; the
+ * UI counts (marks, frames, layers, draws, pixels) carry over to the
+ * watch as they are.  The wakeup scheduler's own counts (src/sched.h)
+ * are reported against a second tick that never stops.
+ *
+ * The app is built with config.h as it stands; the *_PROFILE logs can
+ * be switched on with CFLAGS="-O2 -DTICK_PROFILE" make tick_sim and
+ * shown with -v.  Built with -DFIELD_PROFILE it also reports how often
+ * each face field was computed and the time its producer took.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "config.h"
+#include "pebble_shim.h"
+#include "sched.h"
+#include "complication.h"
+#include "weather.h"
+#include "location.h"
+#include "almanac.h"
+#include "keys.h"
+
+enum {
+    EV_STARTUP,
+    EV_SECOND,
+    EV_MINUTE,
+    EV_HOUR,
+    EV_DAY,
+    EV_MONTH,
+    EV_YEAR,
+    EV_TAP,
+    EV_MESSAGE,
+    EV_TIMER,
+    EV_COUNT
+};
+
+static const char *const event_names[EV_COUNT] = {
+    "startup", "second tick", "minute tick", "hour tick", "day tick", "month tick",
+    "year tick", "tap", "weather message", "timer",
+};
+
+/* event times in 1/16 octave buckets, for the percentiles */
+#define HIST_STEPS   16
+#define HIST_BUCKETS (32 * HIST_STEPS)
+
+typedef struct {
+    unsigned long count;
+    double ns, max_ns;
+    long long max_at;
+    unsigned long hist[HIST_BUCKETS];
+    ShimCounters ui;
+} EventStats;
+
+static EventStats stats[EV_COUNT];
+
+/* simulation settings */
+static long long start_s, end_s;
+static long tap_every = 3600, weather_every = 15 * 60;
+static long jump;
+static int battery_percent = 80;
+static bool send_location;
+static Location location;
+
+int watch_main(void);
+
+static void add_ui(ShimCounters *sum, const ShimCounters *c)
+{
+    sum->marks += c->marks;
+    sum->frames += c->frames;
+    sum->layers += c->layers;
+    sum->texts += c->texts;
+    sum->bitmaps += c->bitmaps;
+    sum->pixels += c->pixels;
+    sum->vibes += c->vibes;
+    sum->sent += c->sent;
+    sum->dropped += c->dropped;
+    sum->persisted += c->persisted;
+}
+
+/* account the time since t0 and the UI work since the last reset */
+static void account(int ev, double t0)
+{
+    EventStats *s = &stats[ev];
+    double ns = bench_now_ns() - t0;
+    int b = ns >= 1 ? (int)(log2(ns) * HIST_STEPS) : 0;
+    s->count++;
+    s->ns += ns;
+    s->hist[b < HIST_BUCKETS ? b : HIST_BUCKETS - 1]++;
+    if (ns > s->max_ns) {
+        s->max_ns = ns;
+        s->max_at = shim_clock();
+    }
+    add_ui(&s->ui, &shim_counters);
+    shim_reset_counters();
+}
+
+/* one event: run it and the frame it causes; true if it sent a message */
+#define RUN_EVENT(ev, call)                                 \
+    do {                                                    \
+        double t0_ = bench_now_ns();                        \
+        call;                                               \
+        shim_render();                                      \
+        sent = shim_counters.sent != 0;                     \
+        account(ev, t0_);                                   \
+    } while (0)
+
+static TimeUnits units_changed(const struct tm *a, const struct tm *b)
+{
+    TimeUnits u = 0;
+    if (a->tm_sec != b->tm_sec) u |= SECOND_UNIT;
+    if (a->tm_min != b->tm_min) u |= MINUTE_UNIT;
+    if (a->tm_hour != b->tm_hour) u |= HOUR_UNIT;
+    if (a->tm_mday != b->tm_mday) u |= DAY_UNIT;
+    if (a->tm_mon != b->tm_mon) u |= MONTH_UNIT;
+    if (a->tm_year != b->tm_year) u |= YEAR_UNIT;
+    return u;
+}
+
+/* upper bound of the bucket holding fraction p of the events */
+static double percentile(const EventStats *e, double p)
+{
+    unsigned long n = 0;
+    int b;
+    for (b = 0; b < HIST_BUCKETS; b++) {
+        n += e->hist[b];
+        if (n >= p * e->count) break;
+    }
+    return exp2((b + 1.0) / HIST_STEPS);
+}
+
+static int tick_event(TimeUnits u)
+{
+    if (u & YEAR_UNIT) return EV_YEAR;
+    if (u & MONTH_UNIT) return EV_MONTH;
+    if (u & DAY_UNIT) return EV_DAY;
+    if (u & HOUR_UNIT) return EV_HOUR;
+    if (u & MINUTE_UNIT) return EV_MINUTE;
+    return EV_SECOND;
+}
+
+/* a report like the phone's, varying over the day */
+static int make_weather(uint8_t *p, long long now)
+{
+    static const char *const conds[] = { "Clear", "Partly Cloudy", "Light Rain", "Overcast" };
+    long k = (long)(now / (15 * 60));
+    int temp = 40 + (int)(k % 96) / 4, bar = 2990 + (int)(k / 4 % 7), n;
+    const char *cond = conds[(k / 8) % 4];
+    uint32_t when = (uint32_t)now;
+
+    n = strlen(cond);
+    p[0] = WEATHER_VERSION;
+    p[1] = (k / 8) % 13;
+    p[2] = temp; p[3] = temp >> 8;
+    p[4] = bar; p[5] = bar >> 8; p[6] = bar >> 16; p[7] = bar >> 24;
+    p[8] = when; p[9] = when >> 8; p[10] = when >> 16; p[11] = when >> 24;
+    p[12] = n;
+    memcpy(p + WEATHER_HEADER_SIZE, cond, n);
+    return WEATHER_HEADER_SIZE + n;
+}
+
+/* the phone's fix, up to 2/100 degree off in either direction */
+static int make_location(uint8_t *p, long long now)
+{
+    long k = (long)(now / (15 * 60));
+    int lat = location.lat + (int)(k * 3 % 5) - 2, lon = location.lon + (int)((k * 2 + 1) % 5) - 2;
+
+    p[0] = LOCATION_VERSION;
+    p[1] = lat; p[2] = lat >> 8;
+    p[3] = lon; p[4] = lon >> 8;
+    p[5] = location.utc_offset; p[6] = location.utc_offset >> 8;
+    return LOCATION_SIZE;
+}
+
+static void deliver_weather(void)
+{
+    uint8_t weather[WEATHER_MAX_SIZE], where[LOCATION_SIZE];
+    ShimBytes tuples[2] = {
+        { WEATHER_KEY, weather, make_weather(weather, shim_clock() / 1000) },
+        { LOCATION_KEY, where, make_location(where, shim_clock() / 1000) },
+    };
+    shim_receive(tuples, send_location ? 2 : 1);
+}
+
+static double startup_t0;
+
+/*
+  Called by the watch's main() after handle_init: the replay itself
+*/
+void app_event_loop(void)
+{
+    struct tm prev, now;
+    time_t t = start_s;
+    long long s, jump_at, reply_at = -1;
+    bool sent = false;
+
+    /* handle_init plus the first frame, which schedules init_deferred */
+    shim_render();
+    account(EV_STARTUP, startup_t0);
+    while (shim_next_timer() >= 0 && shim_next_timer() <= shim_clock())
+        RUN_EVENT(EV_TIMER, shim_run_timer());
+    if (sent) reply_at = start_s + 2;
+
+    gmtime_r(&t, &prev);
+    now = prev;
+    jump_at = jump ? start_s + (end_s - start_s) / 2 : -1;
+    for (s = start_s + 1; s < end_s; s++) {
+        TickHandler handler;
+        TimeUnits u;
+
+        if (s == jump_at) {
+            /* the clock is set; the run still lasts as long */
+            shim_jump_clock(jump * 1000);
+            s += jump;
+            start_s += jump;
+            end_s += jump;
+            if (reply_at >= 0) reply_at += jump;
+            jump_at = -1;
+            t = s;
+            gmtime_r(&t, &now);
+        } else if (++now.tm_sec == 60) {
+            t = s;
+            gmtime_r(&t, &now);
+        }
+        shim_set_clock(s * 1000);
+        u = units_changed(&prev, &now);
+        prev = now;
+
+        handler = shim_tick_handler();
+        if (handler && (u & shim_tick_units())) {
+            struct tm tick = now;
+            RUN_EVENT(tick_event(u), handler(&tick, u));
+            if (sent) reply_at = s + 2;
+        }
+        if (tap_every && (s - start_s) % tap_every == 0) {
+            RUN_EVENT(EV_TAP, shim_tap());
+        }
+        /* the phone's periodic update, and its reply to a refresh */
+        if ((weather_every && (s - start_s) % weather_every == 0) || s == reply_at) {
+            RUN_EVENT(EV_MESSAGE, deliver_weather());
+        }
+        while (shim_next_timer() >= 0 && shim_next_timer() < (s + 1) * 1000) {
+            shim_set_clock(shim_next_timer() > s * 1000 ? shim_next_timer() : s * 1000);
+            RUN_EVENT(EV_TIMER, shim_run_timer());
+            if (sent) reply_at = s + 2;
+        }
+    }
+}
+
+static int parse_start(const char *arg, long long *out)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(arg, "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec) < 3)
+        return -1;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    *out = timegm(&tm);
+    return 0;
+}
+
+static void format_time(char *buf, size_t n, long long ms)
+{
+    time_t t = ms / 1000;
+    struct tm tm;
+    strftime(buf, n, "%Y-%m-%d %H:%M:%S", gmtime_r(&t, &tm));
+}
+
+static void report(void)
+{
+    char when[24];
+    unsigned long ticks = 0;
+    double tick_ns = 0, worst_ns = 0, p99 = 0;
+    long long worst_at = 0, seconds = end_s - start_s;
+    int worst = -1, i;
+    ShimCounters total;
+
+    memset(&total, 0, sizeof(total));
+    printf("%-16s %9s %8s %8s %8s %7s %7s %7s %7s %9s\n", "event", "count", "mean ns", "p99 ns",
+           "max ns", "marks", "frames", "layers", "draws", "pixels");
+    for (i = 0; i < EV_COUNT; i++) {
+        EventStats *e = &stats[i];
+        double n = e->count ? e->count : 1;
+        if (e->count == 0) continue;
+        printf("%-16s %9lu %8.0f %8.0f %8.0f %7.2f %7.2f %7.2f %7.2f %9.0f\n", event_names[i],
+               e->count, e->ns / n, percentile(e, 0.99), e->max_ns, e->ui.marks / n,
+               e->ui.frames / n, e->ui.layers / n,
+               (e->ui.texts + e->ui.bitmaps) / n, e->ui.pixels / n);
+        add_ui(&total, &e->ui);
+        if (i >= EV_SECOND && i <= EV_YEAR) {
+            ticks += e->count;
+            tick_ns += e->ns;
+            if (percentile(e, 0.99) > p99) p99 = percentile(e, 0.99);
+            if (e->max_ns > worst_ns) {
+                worst_ns = e->max_ns;
+                worst_at = e->max_at;
+                worst = i;
+            }
+        }
+    }
+    printf("(UI counts per event: marks = invalidations, layers = layers painted,\n"
+           " draws = text and bitmap draws; max ns includes host scheduling noise)\n\n");
+
+    if (ticks) {
+        format_time(when, sizeof(when), worst_at);
+        printf("tick handler: %lu wakeups in %lld s (%.1f per hour), mean %.0f ns\n",
+               ticks, seconds, ticks * 3600.0 / seconds, tick_ns / ticks);
+        printf("worst tick: %.0f ns (%s at %s); worst p99 of a tick kind %.0f ns\n",
+               worst_ns, event_names[worst], when, p99);
+    }
+    {
+        const SchedStats *st = sched_stats();
+        double per_day = 86400.0 / seconds, wakeups = (st->ticks + st->timers) * per_day;
+        printf("scheduler per day: %.0f wakeups (%.0f ticks, %.0f timers), %.0f deadlines shared a tick;\n"
+               " %.0f wakeups avoided against a second tick throughout\n",
+               wakeups, st->ticks * per_day, st->timers * per_day, st->shared * per_day, 86400 - wakeups);
+    }
+    printf("per simulated day: %.0f frames, %.0f pixels, %.0f ns in the tick handler\n",
+           total.frames * 86400.0 / seconds, total.pixels * 86400.0 / seconds,
+           tick_ns * 86400.0 / seconds);
+    printf("vibrations %lu, messages to the phone %lu, dropped from it %lu, persist writes %lu,\n"
+           " heap peak %lu bytes\n", total.vibes, total.sent, total.dropped, total.persisted,
+           (unsigned long)shim_heap_peak());
+    {
+        const AlmanacStats *st = almanac_stats();
+        printf("almanac days: %lu from the table, %lu from the cache, %lu solved\n",
+               (unsigned long)st->table, (unsigned long)st->cached, (unsigned long)st->solved);
+    }
+}
+
+#ifdef FIELD_PROFILE
+static void report_fields(void)
+{
+    static const char *const names[FIELD_COUNT] = {
+        "time", "ampm", "temp", "cond", "updated", "bar", "sunrise", "sunset", "moonrise",
+        "moonset", "day", "secs", "date", "moon", "moonp", "error",
+    };
+    uint32_t shown = face_shown_mask(), runs, ns;
+    double days = (end_s - start_s) / 86400.0;
+    int i;
+
+    printf("\n%-10s %6s %12s %9s %12s\n", "field", "shown", "runs/day", "ns/run", "ns/day");
+    for (i = 0; i < FIELD_COUNT; i++) {
+        complication_profile(i, &runs, &ns);
+        printf("%-10s %6s %12.1f %9.0f %12.0f\n", names[i], (shown >> i) & 1 ? "yes" : "no",
+               runs / days, runs ? (double)ns / runs : 0.0, ns / days);
+    }
+}
+#endif
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-d days | -y years] [-s YYYY-MM-DD[THH:MM:SS]] [-24] [-t tap_seconds]\n"
+                    "       [-w weather_minutes] [-b battery_percent] [-l lat,lon,utc_minutes]\n"
+                    "       [-j minutes] [-r resources_dir] [-v]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    char when[24];
+    double days = 7;
+    int i, left;
+
+    parse_start("2026-01-01", &start_s);
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-d") && i + 1 < argc) days = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-y") && i + 1 < argc) days = atof(argv[++i]) * 365;
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            if (parse_start(argv[++i], &start_s)) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "-24")) shim_clock_24h = true;
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) tap_every = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc) weather_every = atol(argv[++i]) * 60;
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) battery_percent = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+            float lat, lon;
+            int offset;
+            if (sscanf(argv[++i], "%f,%f,%d", &lat, &lon, &offset) != 3) {
+                usage(argv[0]);
+                return 2;
+            }
+            location.lat = ALMANAC_CENTI(lat);
+            location.lon = ALMANAC_CENTI(lon);
+            location.utc_offset = offset;
+            send_location = true;
+        } else if (!strcmp(argv[i], "-j") && i + 1 < argc) jump = atol(argv[++i]) * 60;
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) shim_resources = argv[++i];
+        else if (!strcmp(argv[i], "-v")) shim_verbose = true;
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    end_s = start_s + (long long)(days * 86400);
+
+    format_time(when, sizeof(when), start_s * 1000);
+#ifdef FACE_CANVAS
+    printf("canvas face, ");
+#else
+    printf("layer face, ");
+#endif
+    printf("%g days from %s, %s clock, ", days, when, shim_clock_24h ? "24h" : "12h");
+    if (tap_every) printf("tap every %ld s, ", tap_every);
+    if (weather_every) printf("weather every %ld min, ", weather_every / 60);
+    printf("battery %d%%", battery_percent);
+    if (send_location)
+        printf(", at %.2f,%.2f UTC%+d min", location.lat / 100.0, location.lon / 100.0, location.utc_offset);
+    if (jump) printf(", clock set %+ld min halfway", jump / 60);
+    printf("\n\n");
+
+    shim_set_clock(start_s * 1000);
+    shim_battery((BatteryChargeState){ .charge_percent = battery_percent });
+    startup_t0 = bench_now_ns();
+    watch_main();
+
+    report();
+#ifdef FIELD_PROFILE
+    report_fields();
+#endif
+    left = shim_live_objects();
+    if (left) printf("%d objects not freed at exit\n", left);
+    return left != 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * The daylight saving rules in src/tz.c against the system's zoneinfo:
+ * every half hour of UT over the years the rules hold for, the
+ * minutes of daylight saving tz_save() gives against the C library's
+ * offset for the matching IANA zone; then an event at 23:30 standard
+ * time every day, which the change dates and the days before them put
+ * after midnight on the wall clock, through tz_local() against the same
+ * zone's wall clock day and hour; then the time per tz_local() call with
+ * the year's changes kept and worked out every call.
+ *
+ *   ./tz_check [first_year [last_year]]     default 2008 2037
+ *
+ * Exits 1 if a zone disagrees anywhere.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "bench.h"
+#include "sunmoon.h"
+#include "tz.h"
+
+#define JD_EPOCH 2440588    /* 1970-01-01 */
+
+static const char *const iana[TZ_ZONES] = {
+    [TZ_UTC]            = "UTC",
+    [TZ_US_HAWAII]      = "Pacific/Honolulu",
+    [TZ_US_ALASKA]      = "America/Anchorage",
+    [TZ_US_PACIFIC]     = "America/Los_Angeles",
+    [TZ_US_ARIZONA]     = "America/Phoenix",
+    [TZ_US_MOUNTAIN]    = "America/Denver",
+    [TZ_US_CENTRAL]     = "America/Chicago",
+    [TZ_US_EASTERN]     = "America/New_York",
+    [TZ_US_ATLANTIC]    = "America/Halifax",
+    [TZ_UK]             = "Europe/London",
+    [TZ_CENTRAL_EUROPE] = "Europe/Paris",
+    [TZ_EASTERN_EUROPE] = "Europe/Helsinki",
+    [TZ_INDIA]          = "Asia/Kolkata",
+    [TZ_CHINA]          = "Asia/Shanghai",
+    [TZ_JAPAN]          = "Asia/Tokyo",
+    [TZ_SYDNEY]         = "Australia/Sydney",
+    [TZ_AUCKLAND]       = "Pacific/Auckland",
+};
+
+static TzYear bench_year;
+
+/* 23:30 standard time of each day through tz_local against the C library */
+static long late_events(const TzZone *zone, int first_jd, int last_jd, int *first_bad)
+{
+    TzYear y;
+    long bad = 0;
+    int jd;
+
+    tz_init(&y, zone);
+    for (jd = first_jd; jd < last_jd; jd++) {
+        time_t t = (time_t)(jd - JD_EPOCH) * 86400 + 23 * 3600 + 30 * 60 - zone->offset * 60L;
+        struct tm tm;
+        float want, got;
+
+        localtime_r(&t, &tm);
+        want = (jdn(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday) - jd) * 24 +
+               tm.tm_hour + tm.tm_min / 60.0f;
+        got = tz_local(&y, jd, 23.5f);
+        if (fabsf(got - want) > 0.001f && bad++ == 0) *first_bad = jd;
+    }
+    return bad;
+}
+
+/* sunrise-like times over a year, the way almanac_day asks */
+static double b_warm(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++)
+        s += tz_local(&bench_year, 2461041 + i % 365, 6.0f + (i % 97) / 60.0f);
+    return s;
+}
+
+static double b_cold(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        tz_init(&bench_year, bench_year.zone);
+        s += tz_local(&bench_year, 2461041 + i % 365, 6.0f + (i % 97) / 60.0f);
+    }
+    return s;
+}
+
+int main(int argc, char **argv)
+{
+    int first = argc > 1 ? atoi(argv[1]) : 2008, last = argc > 2 ? atoi(argv[2]) : 2037;
+    time_t from = (time_t)(jdn(first, 1, 1) - JD_EPOCH) * 86400;
+    time_t to = (time_t)(jdn(last + 1, 1, 1) - JD_EPOCH) * 86400;
+    BenchCase cases[] = {
+        { "tz_local, year kept", b_warm, 1000000 },
+        { "tz_local, year worked out", b_cold, 200000 },
+    };
+    int z, failed = 0;
+
+    printf("%d-%d, every 30 min of UT and 23:30 standard time every day\n\n"
+           "%-22s %6s %6s %10s %10s %s\n", first, last, "zone", "offset", "save", "mismatch",
+           "23:30", "first at");
+    for (z = 0; z < TZ_ZONES; z++) {
+        const TzZone *zone = &tz_zones[z];
+        TzYear y;
+        long bad = 0, late;
+        time_t t, first_bad = 0;
+        int first_late = 0;
+
+        setenv("TZ", iana[z], 1);
+        tzset();
+        tz_init(&y, zone);
+        for (t = from; t < to; t += 1800) {
+            struct tm tm;
+            long std = (long)t + zone->offset * 60L;
+            int want, got;
+
+            localtime_r(&t, &tm);
+            want = (int)(tm.tm_gmtoff / 60) - zone->offset;
+            got = tz_save(&y, JD_EPOCH + (int)(std / 86400), (int)(std % 86400) / 60);
+            if (got != want && bad++ == 0) first_bad = t;
+        }
+        late = late_events(zone, jdn(first, 1, 1), jdn(last + 1, 1, 1), &first_late);
+        printf("%-22s %+6d %6d %10ld %10ld", iana[z], zone->offset, zone->save, bad, late);
+        if (bad || late) {
+            char when[32];
+            struct tm tm;
+            if (!bad) {
+                first_bad = (time_t)(first_late - JD_EPOCH) * 86400 + 23 * 3600 + 30 * 60 -
+                            zone->offset * 60L;
+            }
+            strftime(when, sizeof(when), "%Y-%m-%d %H:%M UT", gmtime_r(&first_bad, &tm));
+            printf(" %s", when);
+            failed = 1;
+        }
+        printf("\n");
+    }
+    printf("\n");
+
+    tz_init(&bench_year, &tz_zones[TZ_US_EASTERN]);
+    bench_main(cases, 2, 10, NULL, NULL);
+    return failed;
+}
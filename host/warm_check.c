@@ -0,0 +1,69 @@
+/*
+ * sunmooncalc_warm, chained day to day the way handle_sunmoon uses it,
+ * against the full sweep of sunmooncalc: rise/set differences in
+ * minutes and time per day.
+ */
+#include <stdio.h>
+#include "bench.h"
+#include "solver_check.h"
+#include "sunmoon.h"
+
+static int bench_obj;
+
+static double b_sweep(long n)
+{
+    double s = 0;
+    float r, t;
+    long i;
+    for (i = 0; i < n; i++) {
+        sunmooncalc_interp(CHECK_JD + i % CHECK_DAYS, -5.0, 33.9616, 83.4299, bench_obj, &r, &t);
+        s += r + t;
+    }
+    return s;
+}
+
+static double b_warm(long n)
+{
+    double s = 0;
+    float r = 99.0, t = 99.0;
+    long i;
+    for (i = 0; i < n; i++) {
+        sunmooncalc_warm(CHECK_JD + i % CHECK_DAYS, -5.0, 33.9616, 83.4299, bench_obj, r, t, &r, &t);
+        s += r + t;
+    }
+    return s;
+}
+
+/* chained from the day before at the same place, as handle_sunmoon does */
+static void pair(int day, float lat, float lon, int obj, float want[2], float got[2])
+{
+    static float r = 99.0, s = 99.0;
+    if (day == 0) r = s = 99.0;
+    sunmooncalc(CHECK_JD + day, 0, lat, lon, obj, &want[0], &want[1]);
+    sunmooncalc_warm(CHECK_JD + day, 0, lat, lon, obj, r, s, &r, &s);
+    got[0] = r;
+    got[1] = s;
+}
+
+int main(void)
+{
+    BenchCase cases[] = {
+        { "sweep (interp)", b_sweep, 20000 },
+        { "warm",           b_warm,  20000 },
+    };
+    char name[2][32];
+    int iobj;
+
+    printf("difference to sunmooncalc (full sweep, exact ephemeris)\n");
+    check_table(pair, 0);
+
+    for (iobj = 0; iobj < 2; iobj++) {
+        bench_obj = iobj;
+        snprintf(name[0], sizeof(name[0]), "%s sweep (interp)", OBJ_NAME[iobj]);
+        snprintf(name[1], sizeof(name[1]), "%s warm", OBJ_NAME[iobj]);
+        cases[0].name = name[0];
+        cases[1].name = name[1];
+        bench_main(cases, 2, 10, NULL, NULL);
+    }
+    return 0;
+}
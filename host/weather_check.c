@@ -0,0 +1,194 @@
+/*
+ * Size on the wire and decode time of the packed weather message
+ * (src/weather.h) against the five-string dictionary it replaced.
+ *
+ *   ./weather_check            compare the two encodings
+ *   ./weather_check HEX        decode one payload, e.g. from the JS side
+ *
+ * The dictionary is laid out the way the watch receives it: a count
+ * byte, then per tuple a 32-bit key, type byte, 16-bit length and the
+ * value (C strings with their NUL).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+#include "mini-printf.h"
+#include "weather.h"
+
+#define TUPLE_HEADER 7
+#define KEY_TEMP     0
+#define KEY_IMAGE    1
+#define KEY_BAR      2
+#define KEY_TIME     3
+#define KEY_COND     4
+
+typedef struct {
+    const char *temp, *icon, *bar, *updated, *cond;
+} Report;
+
+static const Report samples[] = {
+    { "72",  "12", "30.12", "3:45 PM",  "Clear" },
+    { "-4",  "11", "29.80", "11:05 AM", "Light Snow Showers" },
+    { "101", "2",  "29.92", "6:30 PM",  "Scattered Thunderstorms" },
+    { "18",  "4",  "1013.25", "9:15 AM", "Overcast" },
+};
+#define NSAMPLES (int)(sizeof(samples) / sizeof(samples[0]))
+
+static uint8_t dict[NSAMPLES][128];
+static int dict_len[NSAMPLES];
+static uint8_t packed[NSAMPLES][WEATHER_MAX_SIZE];
+static int packed_len[NSAMPLES];
+
+static int put_cstring(uint8_t *p, int key, const char *s)
+{
+    int n = strlen(s) + 1;
+    p[0] = key; p[1] = key >> 8; p[2] = key >> 16; p[3] = key >> 24;
+    p[4] = 1;                       /* TUPLE_CSTRING */
+    p[5] = n; p[6] = n >> 8;
+    memcpy(p + TUPLE_HEADER, s, n);
+    return TUPLE_HEADER + n;
+}
+
+static int encode_dict(uint8_t *p, const Report *r)
+{
+    int n = 1;
+    p[0] = 5;
+    n += put_cstring(p + n, KEY_TEMP, r->temp);
+    n += put_cstring(p + n, KEY_IMAGE, r->icon);
+    n += put_cstring(p + n, KEY_BAR, r->bar);
+    n += put_cstring(p + n, KEY_TIME, r->updated);
+    n += put_cstring(p + n, KEY_COND, r->cond);
+    return n;
+}
+
+/* what encodeWeather() in pebble-js-app.js produces */
+static int encode_packed(uint8_t *p, const Report *r, uint32_t when)
+{
+    int temp = atoi(r->temp), n = strlen(r->cond);
+    uint32_t bar = (uint32_t)(atof(r->bar) * 100 + 0.5);
+    if (n > WEATHER_COND_MAX) n = WEATHER_COND_MAX;
+    p[0] = WEATHER_VERSION;
+    p[1] = atoi(r->icon);
+    p[2] = temp; p[3] = temp >> 8;
+    p[4] = bar; p[5] = bar >> 8; p[6] = bar >> 16; p[7] = bar >> 24;
+    p[8] = when; p[9] = when >> 8; p[10] = when >> 16; p[11] = when >> 24;
+    p[12] = n;
+    memcpy(p + WEATHER_HEADER_SIZE, r->cond, n);
+    return WEATHER_HEADER_SIZE + n;
+}
+
+/* the old watch side: walk the tuples, parse the icon back to a number */
+static long legacy_atol(const char *s)
+{
+    long n = 0;
+    int sign = 1;
+    if (*s == '-' || *s == '+') sign = (*s++ == '-') ? -1 : 1;
+    while (*s >= '0' && *s <= '9') n = n * 10 + (*s++ - '0');
+    return n * sign;
+}
+
+static double decode_dict(const uint8_t *p)
+{
+    const char *text[5] = { 0 };
+    long icon = 0;
+    int i, count = p[0], off = 1;
+    for (i = 0; i < count; i++) {
+        uint32_t key = p[off] | p[off + 1] << 8 | p[off + 2] << 16 | (uint32_t)p[off + 3] << 24;
+        int len = p[off + 5] | p[off + 6] << 8;
+        const char *value = (const char *)p + off + TUPLE_HEADER;
+        if (key == KEY_IMAGE) icon = legacy_atol(value);
+        else if (key < 5) text[key] = value;
+        off += TUPLE_HEADER + len;
+    }
+    return icon + text[KEY_TEMP][0] + text[KEY_COND][0];
+}
+
+/* the strings show_weather() in main.c builds from a decoded report */
+static double format_weather(const Weather *w)
+{
+    static char temp_text[12], bar_text[12], updated_text[8];
+    time_t t = w->time;
+    mini_snprintf(temp_text, sizeof(temp_text), "%d\xc2\xb0", w->temp);
+    mini_snprintf(bar_text, sizeof(bar_text), "%d.%02d", (int)(w->bar / 100), (int)(w->bar % 100));
+    strftime(updated_text, sizeof(updated_text), "%I:%M%p", gmtime(&t));
+    return temp_text[0] + bar_text[0] + updated_text[0];
+}
+
+static double b_dict(long n)
+{
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) s += decode_dict(dict[i % NSAMPLES]);
+    return s;
+}
+
+static double b_packed(long n)
+{
+    Weather w;
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        int k = i % NSAMPLES;
+        s += weather_decode(packed[k], packed_len[k], &w) + w.icon;
+    }
+    return s;
+}
+
+static double b_packed_format(long n)
+{
+    Weather w;
+    double s = 0;
+    long i;
+    for (i = 0; i < n; i++) {
+        int k = i % NSAMPLES;
+        weather_decode(packed[k], packed_len[k], &w);
+        s += format_weather(&w);
+    }
+    return s;
+}
+
+static int decode_hex(const char *hex)
+{
+    uint8_t buf[256];
+    Weather w;
+    int n = 0;
+    unsigned v;
+    while (n < (int)sizeof(buf) && sscanf(hex + 2 * n, "%2x", &v) == 1) buf[n++] = v;
+    if (!weather_decode(buf, n, &w)) {
+        printf("%d bytes: not a version %d weather payload\n", n, WEATHER_VERSION);
+        return 1;
+    }
+    printf("%d bytes: temp %d, icon %d, bar %lu.%02lu, time %lu, cond \"%s\"\n",
+           n, w.temp, w.icon, (unsigned long)(w.bar / 100), (unsigned long)(w.bar % 100),
+           (unsigned long)w.time, w.cond);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const BenchCase cases[] = {
+        { "dictionary walk + atol",      b_dict,          2000000 },
+        { "weather_decode",              b_packed,        2000000 },
+        { "weather_decode + formatting", b_packed_format,  500000 },
+    };
+    int i, dict_total = 0, packed_total = 0;
+
+    if (argc > 1) return decode_hex(argv[1]);
+
+    printf("%-26s %8s %8s\n", "report", "dict", "packed");
+    for (i = 0; i < NSAMPLES; i++) {
+        dict_len[i] = encode_dict(dict[i], &samples[i]);
+        packed_len[i] = 1 + TUPLE_HEADER +
+                        encode_packed(packed[i], &samples[i], 1400000000u + i);
+        printf("%-26s %8d %8d\n", samples[i].cond, dict_len[i], packed_len[i]);
+        dict_total += dict_len[i];
+        packed_total += packed_len[i];
+        packed_len[i] -= 1 + TUPLE_HEADER;
+    }
+    printf("%-26s %8d %8d  (%.0f%% of the dictionary)\n\n", "total", dict_total, packed_total,
+           100.0 * packed_total / dict_total);
+
+    return bench_main(cases, 3, 10, NULL, NULL);
+}
@@ -0,0 +1,251 @@
+#include <pebble.h>
+#include "almanac.h"
+#include "config.h"
+#include "keys.h"
+#include "sunmoon.h"
+#include "tz.h"
+
+#define CACHE_VERSION 1
+
+static ResHandle almanac_res;
+static int almanac_first_jd;
+static int almanac_days = -1;       // -1 = header not read yet, 0 = unusable
+static Location almanac_for;        // where the table was made for
+
+// Where the watch is, as set; days are for solved_for, in its standard time
+static Location location, solved_for;
+static bool location_set;
+static TzYear zone;
+
+// Solved days, stored whole under PERSIST_ALMANAC (about 170 bytes)
+typedef struct {
+    int32_t jd;                     // 0 = empty
+    int16_t lat_cell, lon_cell;
+    int16_t utc_offset;
+    uint8_t record[ALMANAC_RECORD_SIZE];
+} CacheEntry;
+
+static struct {
+    uint8_t version;
+    uint8_t next;                   // entry replaced next
+    CacheEntry entry[ALMANAC_CACHE_ENTRIES];
+} cache;
+static bool cache_read;
+
+// rise/set of the last solved day; the next day at the same place warm-starts
+static RiseSet sun_rs, moon_rs;
+
+static AlmanacStats stats;
+
+static int16_t le16(const uint8_t* p)
+{
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static float minutes_to_hours(int m)
+{
+    return (m == ALMANAC_NONE) ? 99.0 : m / 60.0;
+}
+
+static int hours_to_minutes(float h)
+{
+    return (h == 99.0) ? ALMANAC_NONE : (int)(h * 60 + 0.5);
+}
+
+static void unpack(const uint8_t* r, AlmanacDay* day)
+{
+    int sunrise = (uint16_t)le16(r);
+    day->sunrise = minutes_to_hours(sunrise & ALMANAC_MIN_MASK);
+    day->sunset = minutes_to_hours(le16(r + 2) & ALMANAC_MIN_MASK);
+    day->moonrise = minutes_to_hours(le16(r + 4) & ALMANAC_MIN_MASK);
+    day->moonset = minutes_to_hours(le16(r + 6) & ALMANAC_MIN_MASK);
+    day->phase = sunrise >> ALMANAC_PHASE_SHIFT;
+}
+
+// The table's own format, so cached days read back exactly like table days
+static void pack(const AlmanacDay* day, uint8_t* r)
+{
+    int m[4] = {
+        hours_to_minutes(day->sunrise) | (day->phase << ALMANAC_PHASE_SHIFT),
+        hours_to_minutes(day->sunset),
+        hours_to_minutes(day->moonrise),
+        hours_to_minutes(day->moonset)
+    };
+    int i;
+    for (i = 0; i < 4; i++) {
+        r[2 * i] = m[i] & 0xff;
+        r[2 * i + 1] = m[i] >> 8;
+    }
+}
+
+// Read and check the header once
+static void almanac_open(void)
+{
+    uint8_t h[ALMANAC_HEADER_SIZE];
+    almanac_days = 0;
+    almanac_res = resource_get_handle(RESOURCE_ID_ALMANAC);
+    if (resource_load_byte_range(almanac_res, 0, h, sizeof(h)) != sizeof(h)) return;
+    if (memcmp(h, ALMANAC_MAGIC, 4) != 0) return;
+    almanac_for.lat = le16(h + 10);
+    almanac_for.lon = le16(h + 12);
+    almanac_for.utc_offset = le16(h + 14) * 60 / 100;
+    almanac_first_jd = h[4] | (h[5] << 8) | (h[6] << 16) | (h[7] << 24);
+    almanac_days = (uint16_t)le16(h + 8);
+}
+
+// From the table if it covers jd and was made for this cell
+static bool table_lookup(int jd, AlmanacDay* day)
+{
+    uint8_t r[ALMANAC_RECORD_SIZE];
+    if (almanac_days < 0) almanac_open();
+    if (jd < almanac_first_jd || jd >= almanac_first_jd + almanac_days) return false;
+    if (!location_same_cell(&almanac_for, &solved_for)) return false;
+    if (resource_load_byte_range(almanac_res,
+                                 ALMANAC_HEADER_SIZE + (jd - almanac_first_jd) * ALMANAC_RECORD_SIZE,
+                                 r, sizeof(r)) != sizeof(r)) return false;
+    unpack(r, day);
+    return true;
+}
+
+static CacheEntry* cache_find(int jd)
+{
+    int i;
+    if (!cache_read) {
+        cache_read = true;
+        if (persist_read_data(PERSIST_ALMANAC, &cache, sizeof(cache)) != sizeof(cache) ||
+            cache.version != CACHE_VERSION) {
+            memset(&cache, 0, sizeof(cache));
+            cache.version = CACHE_VERSION;
+        }
+    }
+    for (i = 0; i < ALMANAC_CACHE_ENTRIES; i++) {
+        CacheEntry* e = &cache.entry[i];
+        if (e->jd == jd && e->lat_cell == location_cell(solved_for.lat) &&
+            e->lon_cell == location_cell(solved_for.lon) && e->utc_offset == solved_for.utc_offset) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void cache_insert(int jd, const AlmanacDay* day)
+{
+    CacheEntry* e = &cache.entry[cache.next];
+    cache.next = (cache.next + 1) % ALMANAC_CACHE_ENTRIES;
+    e->jd = jd;
+    e->lat_cell = location_cell(solved_for.lat);
+    e->lon_cell = location_cell(solved_for.lon);
+    e->utc_offset = solved_for.utc_offset;
+    pack(day, e->record);
+    persist_write_data(PERSIST_ALMANAC, &cache, sizeof(cache));
+}
+
+// Everyone in the cell gets the times for its centre
+static void solve(int jd, AlmanacDay* day)
+{
+    float lat, lon, tz = solved_for.utc_offset / 60.0;
+    location_cell_centre(&solved_for, &lat, &lon);
+    riseset_update(&sun_rs, jd, tz, lat, -lon, 1);
+    riseset_update(&moon_rs, jd, tz, lat, -lon, 0);
+    day->sunrise = sun_rs.rise;
+    day->sunset = sun_rs.set;
+    day->moonrise = moon_rs.rise;
+    day->moonset = moon_rs.set;
+    day->phase = (int)(moon_phase(jd)*27 + 0.5);
+}
+
+/*
+  The phone gives the offset in force now.  One that is the home zone's
+  standard or daylight saving offset is taken to be the home zone and
+  follows its rules; anywhere else that offset is all there is.
+*/
+void almanac_set_location(const Location* loc)
+{
+    const TzZone* home = &tz_zones[ZONE];
+
+    location = *loc;
+    solved_for = *loc;
+    location_set = true;
+    if (loc->utc_offset == home->offset ||
+        (home->save != 0 && loc->utc_offset == home->offset + home->save)) {
+        solved_for.utc_offset = home->offset;
+        tz_init(&zone, home);
+    } else {
+        tz_init(&zone, &tz_zones[TZ_UTC]);
+    }
+}
+
+const Location* almanac_location(void)
+{
+    if (!location_set) {
+        Location home = { ALMANAC_CENTI(LAT), ALMANAC_CENTI(LON), tz_zones[ZONE].offset };
+        almanac_set_location(&home);
+    }
+    return &location;
+}
+
+// The day in standard time
+static void standard_day(int jd, AlmanacDay* day)
+{
+    CacheEntry* e;
+    uint8_t r[ALMANAC_RECORD_SIZE];
+
+    if (table_lookup(jd, day)) {
+        stats.table++;
+        return;
+    }
+    e = cache_find(jd);
+    if (e != NULL) {
+        stats.cached++;
+        unpack(e->record, day);
+        return;
+    }
+    stats.solved++;
+    solve(jd, day);
+    cache_insert(jd, day);
+    // what the next launch will read back, minute-rounded like the table
+    pack(day, r);
+    unpack(r, day);
+}
+
+// The day on the wall clock, with events it pushed past midnight still in it
+static void wall_day(int jd, AlmanacDay* day)
+{
+    standard_day(jd, day);
+    day->sunrise = tz_local(&zone, jd, day->sunrise);
+    day->sunset = tz_local(&zone, jd, day->sunset);
+    day->moonrise = tz_local(&zone, jd, day->moonrise);
+    day->moonset = tz_local(&zone, jd, day->moonset);
+}
+
+// The day's own event if it is before midnight, else one the day before pushed over
+static float on_day(float event, float before)
+{
+    if (event < 24) return event;
+    return before != 99.0 && before >= 24 ? before - 24 : 99.0;
+}
+
+/*
+  While daylight saving is on, the first hour of the wall clock day is
+  the last hour of the standard day before, so that day is looked up
+  too for events daylight saving moved into this one
+*/
+void almanac_day(int jd, AlmanacDay* day)
+{
+    AlmanacDay before = { 99.0, 99.0, 99.0, 99.0, 0 };
+
+    almanac_location();
+    wall_day(jd, day);
+    if (tz_save(&zone, jd - 1, 1439) != 0) {
+        wall_day(jd - 1, &before);
+    }
+    day->sunrise = on_day(day->sunrise, before.sunrise);
+    day->sunset = on_day(day->sunset, before.sunset);
+    day->moonrise = on_day(day->moonrise, before.moonrise);
+    day->moonset = on_day(day->moonset, before.moonset);
+}
+
+const AlmanacStats* almanac_stats(void)
+{
+    return &stats;
+}
@@ -0,0 +1,56 @@
+#ifndef ALMANAC_H
+#define ALMANAC_H
+
+#include <stdint.h>
+#include "location.h"
+
+/*
+ * Per-day sunrise/sunset, moonrise/moonset and moon phase for where the
+ * watch is.  For the location in config.h they are precomputed on the
+ * build host (host/almanac_gen) into the raw ALMANAC resource; anywhere
+ * else a day is solved once per location cell (location.h) and kept in
+ * persistent storage, so the last few days and places survive restarts.
+ * All of them are in the zone's standard time; almanac_day() puts them
+ * on the wall clock with its daylight saving rules (tz.h) and gives the
+ * events of the wall clock day, so one daylight saving moves past
+ * midnight shows the day after.
+ *
+ * Layout, all little-endian:
+ *   header  "ALM1", int32 first jd, uint16 days,
+ *           int16 lat, lon, standard time UTC offset in 1/100 degree/hour
+ *   per day uint16 sunrise, sunset, moonrise, moonset in standard time minutes
+ *           (ALMANAC_NONE = no event); bits 11-15 of sunrise hold the
+ *           moon phase index 0-27
+ */
+#define ALMANAC_MAGIC        "ALM1"
+#define ALMANAC_HEADER_SIZE  16
+#define ALMANAC_RECORD_SIZE  8
+#define ALMANAC_NONE         0x7ff
+#define ALMANAC_MIN_MASK     0x7ff
+#define ALMANAC_PHASE_SHIFT  11
+#define ALMANAC_CENTI(x)     ((int)((x) * 100 + ((x) < 0 ? -0.5 : 0.5)))
+
+// solved days kept in PERSIST_ALMANAC, oldest replaced first
+#define ALMANAC_CACHE_ENTRIES  8
+
+typedef struct {
+    float sunrise, sunset;      // wall clock hours, 99.0 = none
+    float moonrise, moonset;
+    int phase;                  // 0-27, 0 = new moon, 14 = full
+} AlmanacDay;
+
+// Where the days are for; config.h's location and ZONE until this is called
+void almanac_set_location(const Location* loc);
+const Location* almanac_location(void);
+
+// The day at the current location, from the table, the cache or the solver
+void almanac_day(int jd, AlmanacDay* day);
+
+// Where almanac_day() found its days
+typedef struct {
+    uint32_t table, cached, solved;
+} AlmanacStats;
+
+const AlmanacStats* almanac_stats(void);
+
+#endif // ALMANAC_H
@@ -0,0 +1,41 @@
+#include <pebble.h>
+#include "atlas.h"
+
+static GBitmap* atlas;
+static GBitmap* icons[ATLAS_ICONS];
+static GBitmap* status[ATLAS_STATUS_COUNT];
+
+void atlas_load(void)
+{
+    int i;
+    atlas = gbitmap_create_with_resource(RESOURCE_ID_ICON_ATLAS_BLACK);
+    for (i = 0; i < ATLAS_ICONS; i++) {
+        GRect r = GRect((i % ATLAS_COLUMNS) * ATLAS_ICON_SIZE, (i / ATLAS_COLUMNS) * ATLAS_ICON_SIZE,
+                        ATLAS_ICON_SIZE, ATLAS_ICON_SIZE);
+        icons[i] = gbitmap_create_as_sub_bitmap(atlas, r);
+    }
+    for (i = 0; i < ATLAS_STATUS_COUNT; i++) {
+        GRect r = GRect(i * ATLAS_STATUS_W, ATLAS_STATUS_Y, ATLAS_STATUS_W, ATLAS_STATUS_H);
+        status[i] = gbitmap_create_as_sub_bitmap(atlas, r);
+    }
+}
+
+void atlas_unload(void)
+{
+    int i;
+    if (atlas == NULL) return;
+    for (i = 0; i < ATLAS_ICONS; i++) gbitmap_destroy(icons[i]);
+    for (i = 0; i < ATLAS_STATUS_COUNT; i++) gbitmap_destroy(status[i]);
+    gbitmap_destroy(atlas);
+}
+
+GBitmap* atlas_icon(int index)
+{
+    if (index < 0 || index >= ATLAS_ICONS) index = ATLAS_ICON_UNKNOWN;
+    return icons[index];
+}
+
+GBitmap* atlas_status(int glyph)
+{
+    return status[glyph];
+}
@@ -0,0 +1,45 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+/*
+ * All bitmaps the face shows, packed into the one ICON_ATLAS image by
+ * host/atlas_pack and loaded once.  Sprites are sub-bitmap views into
+ * it, created with the atlas, so swapping an icon never touches the
+ * heap or flash.
+ *
+ * Layout: the weather icons in phone index order, ATLAS_COLUMNS per
+ * row, then one row of status glyphs below them.
+ */
+#define ATLAS_ICON_SIZE    70
+#define ATLAS_ICONS        15
+#define ATLAS_ICON_UNKNOWN 13
+#define ATLAS_COLUMNS      5
+#define ATLAS_STATUS_Y     (((ATLAS_ICONS + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS) * ATLAS_ICON_SIZE)
+#define ATLAS_STATUS_W     17
+#define ATLAS_STATUS_H     9
+#define ATLAS_WIDTH        (ATLAS_COLUMNS * ATLAS_ICON_SIZE)
+#define ATLAS_HEIGHT       (ATLAS_STATUS_Y + ATLAS_STATUS_H)
+
+// Status glyphs, left to right in the bottom row
+enum AtlasStatus {
+  ATLAS_BATT_000_020,
+  ATLAS_BATT_020_040,
+  ATLAS_BATT_040_060,
+  ATLAS_BATT_060_080,
+  ATLAS_BATT_080_100,
+  ATLAS_BATT_CHARGING,
+  ATLAS_BT_ON,
+  ATLAS_BT_OFF,
+  ATLAS_STATUS_COUNT
+};
+
+struct GBitmap;
+
+void atlas_load(void);
+void atlas_unload(void);
+
+// Weather icon by the phone's index; anything unknown gets the "?" icon
+struct GBitmap* atlas_icon(int index);
+struct GBitmap* atlas_status(int status);
+
+#endif // ATLAS_H
@@ -0,0 +1,101 @@
+#include <pebble.h>
+#include "complication.h"
+#include "profile.h"
+
+// Units a cadence can name, SECOND_UNIT .. DAY_UNIT
+#define UNIT_COUNT 4
+
+static const Complication *table;
+// Fields to produce at each unit's boundary
+static uint32_t due_at[UNIT_COUNT];
+// Shown fields produced since they started showing
+static uint32_t produced;
+
+#ifdef FIELD_PROFILE
+static uint32_t profile_runs[FIELD_COUNT];
+static uint32_t profile_time[FIELD_COUNT];
+#endif
+
+void complication_init( const Complication *complications ) {
+  int i, u;
+
+  table = complications;
+  produced = 0;
+  for ( u = 0; u < UNIT_COUNT; u++ ) {
+    due_at[u] = 0;
+    for ( i = 0; i < FIELD_COUNT; i++ ) {
+      if ( table[i].produce != NULL && ( table[i].cadence & ( 1u << u ) ) ) {
+        due_at[u] |= 1u << i;
+      }
+    }
+  }
+}
+
+static void produce( int i, struct tm *now ) {
+  const char *text;
+#ifdef FIELD_PROFILE
+  uint32_t start = profile_ticks();
+#endif
+
+  text = table[i].produce( now );
+#ifdef FIELD_PROFILE
+  profile_runs[i]++;
+  profile_time[i] += profile_ticks() - start;
+#endif
+  if ( text != NULL ) {
+    face_set_text( i, text );
+  }
+  produced |= 1u << i;
+}
+
+void complication_update( struct tm *now, TimeUnits units ) {
+  uint32_t shown = face_shown_mask(), due = 0;
+  int i, u;
+
+  for ( u = 0; u < UNIT_COUNT; u++ ) {
+    if ( units & ( 1u << u ) ) {
+      due |= due_at[u];
+    }
+  }
+  // a hidden field starts over when it shows again
+  produced &= shown;
+  due = ( due | ~produced ) & shown;
+  if ( due == 0 ) {
+    return;
+  }
+
+  face_begin();
+  for ( i = 0; i < FIELD_COUNT; i++ ) {
+    if ( ( due & ( 1u << i ) ) && table[i].produce != NULL ) {
+      produce( i, now );
+    }
+  }
+  face_commit();
+}
+
+void complication_refresh( FaceField field ) {
+  time_t now;
+
+  if ( !( face_shown_mask() & ( 1u << field ) ) || table[field].produce == NULL ) {
+    return;
+  }
+  now = time( NULL );
+  produce( field, localtime( &now ) );
+}
+
+#ifdef FIELD_PROFILE
+void complication_profile( FaceField field, uint32_t *runs, uint32_t *ticks ) {
+  *runs = profile_runs[field];
+  *ticks = profile_time[field];
+}
+
+void complication_log_profile( void ) {
+  int i;
+  for ( i = 0; i < FIELD_COUNT; i++ ) {
+    if ( profile_runs[i] > 0 ) {
+      APP_LOG( APP_LOG_LEVEL_INFO, "field %d: %d runs, %d " PROFILE_TICKS, i,
+               (int)profile_runs[i], (int)profile_time[i] );
+    }
+  }
+}
+#endif
@@ -0,0 +1,37 @@
+#ifndef COMPLICATION_H
+#define COMPLICATION_H
+
+#include <pebble.h>
+#include "config.h"
+#include "face.h"
+
+/*
+ * What each face field shows and when it changes.  A field's producer
+ * formats its text (into a buffer the producer owns) and runs only
+ * while the field is shown (face_shown_mask): at every boundary of its
+ * cadence, on complication_refresh, and once when it starts showing.
+ * A field that never shows is never computed.
+ */
+typedef const char *(*Producer)( struct tm *now );  // NULL = text unchanged
+
+typedef struct {
+  TimeUnits cadence;    // 0: only on complication_refresh
+  Producer produce;     // NULL: set directly with face_set_text
+} Complication;
+
+// table has FIELD_COUNT entries and must stay valid
+void complication_init( const Complication *table );
+
+// Fields due at the units that changed, and shown fields not yet produced
+void complication_update( struct tm *now, TimeUnits units );
+
+// Run one field's producer now, if the field shows; its inputs changed
+void complication_refresh( FaceField field );
+
+#ifdef FIELD_PROFILE
+// Runs and time (profile_ticks units) per field since startup
+void complication_profile( FaceField field, uint32_t *runs, uint32_t *ticks );
+void complication_log_profile( void );
+#endif
+
+#endif // COMPLICATION_H
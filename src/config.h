@@ -1,4 +1,15 @@
 #define LAT 33.9616
 #define LON -83.4299  //East=positive, West=negative
-#define TZ -5.0 //TZ offset from UTC
-#define DATEFMT "%m/%d/%Y" //Date format  North American style: %m/%d/%Y  Europian style: %d/%m/%Y
\ No newline at end of file
+#define ZONE TZ_US_EASTERN //Time zone of the place above, with its daylight saving rules (tz.h)
+#define DATEFMT "%m/%d/%Y" //Date format  North American style: %m/%d/%Y  Europian style: %d/%m/%Y
+//#define SUNMOON_FIXED //Integer-only rise/set solver (sunmoon_fixed.c) instead of the float one
+#define FACE_CANVAS //Draw all fields from one Layer, repainting only what changed, instead of one TextLayer each
+//#define FACE_PROFILE //Log heap used by the face and its draw time
+#define LOW_BATTERY 20 //Battery percent below which seconds only show briefly after a tap
+#define IDLE_SECONDS 600 //Seconds without a wrist tap before dropping to minute ticks
+#define TAP_SECONDS 30 //Seconds shown after a tap while the battery is low
+//#define TICK_PROFILE //Log tick wakeups per hour in second and minute mode
+#define WEATHER_STALE 1800 //Seconds without a weather update before the phone is asked for one
+//#define STARTUP_PROFILE //Log how long startup takes before and after the first frame
+//#define SHOW_MOONP //Show the moon's illuminated percent under the temperature
+//#define FIELD_PROFILE //Log how often each face field is computed and the time it takes, every hour
@@ -0,0 +1,459 @@
+#include <pebble.h>
+#include "config.h"
+#include "face.h"
+#include "profile.h"
+
+#define ConstantGRect(x, y, w, h) {{(x), (y)}, {(w), (h)}}
+#define FG_COLOR GColorWhite
+
+// Fonts before FONT_DEFERRED are loaded by face_init, the rest by
+// face_init_deferred once the first frame is up
+enum FaceFont {
+  FONT_DATE,
+  FONT_TIME,
+  FONT_TEMP,
+  FONT_COND,
+  FONT_MOON,
+  FONT_COUNT,
+  FONT_DEFERRED = FONT_TEMP,
+  FONT_SYSTEM = FONT_COUNT  // FONT_KEY_GOTHIC_14_BOLD
+};
+
+static const uint32_t FONT_RESOURCES[FONT_COUNT] = {
+  [FONT_DATE]  = RESOURCE_ID_FONT_ROBOTO_CONDENSED_20,
+  [FONT_TIME]  = RESOURCE_ID_FONT_ROBOTO_BOLD_SUBSET_41,
+  [FONT_TEMP]  = RESOURCE_ID_FONT_FUTURA_TEMP_18,
+  [FONT_COND]  = RESOURCE_ID_FONT_FUTURA_CONDITIONS_12,
+  [FONT_MOON]  = RESOURCE_ID_FONT_MOON_PHASES_SUBSET_24
+};
+
+typedef struct {
+  GRect rect;
+  GTextAlignment align;
+  uint8_t font;
+  bool hidden;    // until face_set_shown
+} FieldLayout;
+
+// Fields in drawing order (x, y, width, height)
+static const FieldLayout fields[FIELD_COUNT] = {
+  [FIELD_TIME]     = { ConstantGRect(5, 66, 114, 60),          GTextAlignmentCenter, FONT_TIME },
+  [FIELD_AMPM]     = { ConstantGRect(116, 89, 144-116, 28),    GTextAlignmentCenter, FONT_DATE },
+  [FIELD_TEMP]     = { ConstantGRect(5, 0, 75, 26),            GTextAlignmentLeft,   FONT_TEMP },
+  [FIELD_COND]     = { ConstantGRect(44, 53, 99, 20),          GTextAlignmentRight,  FONT_COND },
+  [FIELD_UPDATED]  = { ConstantGRect(2, 53, 75, 20),           GTextAlignmentLeft,   FONT_COND },
+  [FIELD_BAR]      = { ConstantGRect(44, 0, 100, 26),          GTextAlignmentRight,  FONT_COND },
+  [FIELD_SUNRISE]  = { ConstantGRect(5, 145, 75, 20),          GTextAlignmentLeft,   FONT_COND },
+  [FIELD_SUNSET]   = { ConstantGRect(39, 145, 100, 20),        GTextAlignmentRight,  FONT_COND },
+  [FIELD_MOONRISE] = { ConstantGRect(29, 145, 33, 20),         GTextAlignmentRight,  FONT_COND },
+  [FIELD_MOONSET]  = { ConstantGRect(82, 145, 33, 20),         GTextAlignmentLeft,   FONT_COND },
+  [FIELD_DAY]      = { ConstantGRect(5, 117, 144, 33),         GTextAlignmentLeft,   FONT_DATE },
+  [FIELD_SECS]     = { ConstantGRect(119, 70, 144-116, 28),    GTextAlignmentCenter, FONT_DATE },
+  [FIELD_DATE]     = { ConstantGRect(1, 117, 144-1, 168-118),  GTextAlignmentRight,  FONT_DATE },
+  [FIELD_MOON]     = { ConstantGRect(0, 142, 144, 168-142),    GTextAlignmentCenter, FONT_MOON },
+#ifdef SHOW_MOONP
+  [FIELD_MOONP]    = { ConstantGRect(5, 30, 30, 20),           GTextAlignmentLeft,   FONT_COND },
+#else
+  [FIELD_MOONP]    = { ConstantGRect(5, 30, 30, 20),           GTextAlignmentLeft,   FONT_COND, true },
+#endif
+  [FIELD_ERROR]    = { ConstantGRect(0, 35, 144, 26),          GTextAlignmentLeft,   FONT_SYSTEM, true }
+};
+
+static const GRect image_rect[IMAGE_COUNT] = {
+  [IMAGE_WEATHER]   = ConstantGRect(35, 0, 70, 70),
+  [IMAGE_BATTERY]   = ConstantGRect(123, 94, 17, 9),
+  [IMAGE_BLUETOOTH] = ConstantGRect(4, 94, 17, 9)
+};
+
+// Images are redrawn like fields, with the bits past the text fields
+#define REGION_IMAGE(i) (FIELD_COUNT + (i))
+#define REGION_COUNT    (FIELD_COUNT + IMAGE_COUNT)
+#define REGION_ALL    ((1u << REGION_COUNT) - 1)
+
+static const char *field_text[FIELD_COUNT];
+// Fields wanted on screen, and those whose font is loaded
+static uint32_t visible, ready;
+static GFont fonts[FONT_COUNT + 1];
+static GBitmap *background_image = NULL;
+static GBitmap *image[IMAGE_COUNT];
+
+#ifdef FACE_CANVAS
+static Layer *canvas_layer;
+// Regions changed since the last frame, and for each region the regions
+// whose rect overlaps it (itself included)
+static uint32_t dirty;
+static bool batching;
+static uint32_t overlap[REGION_COUNT];
+// Background behind each region, so a region can be cleared on its own;
+// NULL until the region is first shown
+static GBitmap *region_background[REGION_COUNT];
+#else
+static TextLayer *field_layer[FIELD_COUNT];  // NULL until first shown
+static BitmapLayer *background_layer;
+static BitmapLayer *image_layer[IMAGE_COUNT];
+#endif
+
+// Empty layer on top of the face that reports the first frame, then goes
+static Layer *first_frame_layer;
+static AppTimerCallback first_frame_callback;
+
+static void first_frame_update( Layer *layer, GContext *ctx ) {
+  if ( first_frame_callback != NULL ) {
+    app_timer_register( 0, first_frame_callback, NULL );
+    first_frame_callback = NULL;
+  }
+}
+
+#ifdef FACE_PROFILE
+/*
+  Draw time of everything between two empty probe layers, one added
+  before and one after the face, logged every PROFILE_FRAMES frames
+*/
+#define PROFILE_FRAMES 60
+static Layer *probe_first;
+static Layer *probe_last;
+static uint32_t draw_start, draw_total, draw_max, draw_frames;
+static uint32_t redraw_regions, redraw_pixels;
+
+static void probe_first_update( Layer *layer, GContext *ctx ) {
+  draw_start = profile_ms();
+}
+
+static void probe_last_update( Layer *layer, GContext *ctx ) {
+  uint32_t t = profile_ms() - draw_start;
+  draw_total += t;
+  if ( t > draw_max ) draw_max = t;
+#ifndef FACE_CANVAS
+  // every layer of the tree is repainted on each frame
+  redraw_regions += REGION_COUNT;
+  redraw_pixels += 144 * 168;
+#endif
+  if ( ++draw_frames == PROFILE_FRAMES ) {
+    APP_LOG( APP_LOG_LEVEL_INFO, "face draw: avg %d ms, max %d ms over %d frames",
+             (int)( draw_total / draw_frames ), (int)draw_max, (int)draw_frames );
+    APP_LOG( APP_LOG_LEVEL_INFO, "face redraw: %d regions, %d pixels per frame",
+             (int)( redraw_regions / draw_frames ), (int)( redraw_pixels / draw_frames ) );
+    draw_total = draw_max = draw_frames = 0;
+    redraw_regions = redraw_pixels = 0;
+  }
+}
+#endif
+
+#ifdef FACE_CANVAS
+static GRect region_rect( int region ) {
+  return region < FIELD_COUNT ? fields[region].rect : image_rect[region - FIELD_COUNT];
+}
+
+static bool rects_overlap( GRect a, GRect b ) {
+  return a.origin.x < b.origin.x + b.size.w && b.origin.x < a.origin.x + a.size.w &&
+         a.origin.y < b.origin.y + b.size.h && b.origin.y < a.origin.y + a.size.h;
+}
+
+static void mark_region( int region ) {
+  dirty |= 1u << region;
+  if ( !batching ) {
+    layer_mark_dirty( canvas_layer );
+  }
+}
+
+/*
+  Repaint only the regions marked since the last frame.  The window has
+  no background colour, so the rest of the frame buffer keeps what the
+  previous frame left there.  Each dirty region gets its slice of the
+  background back, then every field overlapping one of them is drawn
+  again.  A frame nobody asked for finds nothing marked and repaints
+  everything, as does the first one after the window comes back on
+  screen (face_appear), whatever was marked meanwhile.
+*/
+static void canvas_update( Layer *layer, GContext *ctx ) {
+  uint32_t draw = 0;
+  int i;
+
+  if ( dirty == 0 || dirty == REGION_ALL ) {
+    graphics_draw_bitmap_in_rect( ctx, background_image, layer_get_bounds( layer ) );
+    draw = REGION_ALL;
+#ifdef FACE_PROFILE
+    redraw_regions += REGION_COUNT;
+    redraw_pixels += 144 * 168;
+#endif
+  } else {
+    for ( i = 0; i < REGION_COUNT; i++ ) {
+      if ( dirty & ( 1u << i ) ) {
+        GRect rect = region_rect( i );
+        if ( region_background[i] != NULL ) {
+          graphics_draw_bitmap_in_rect( ctx, region_background[i], rect );
+        }
+        draw |= overlap[i];
+#ifdef FACE_PROFILE
+        redraw_regions++;
+        redraw_pixels += rect.size.w * rect.size.h;
+#endif
+      }
+    }
+  }
+  dirty = 0;
+
+  graphics_context_set_text_color( ctx, FG_COLOR );
+  draw &= face_shown_mask() | ~( ( 1u << FIELD_COUNT ) - 1 );
+  for ( i = 0; i < FIELD_COUNT; i++ ) {
+    if ( ( draw & ( 1u << i ) ) && field_text[i] != NULL ) {
+      graphics_draw_text( ctx, field_text[i], fonts[fields[i].font], fields[i].rect,
+                          GTextOverflowModeWordWrap, fields[i].align, NULL );
+    }
+  }
+  for ( i = 0; i < IMAGE_COUNT; i++ ) {
+    if ( ( draw & ( 1u << REGION_IMAGE( i ) ) ) && image[i] != NULL ) {
+      graphics_draw_bitmap_in_rect( ctx, image[i], image_rect[i] );
+    }
+  }
+}
+#else
+/*
+  Setup new TextLayer
+*/
+static TextLayer * setup_text_layer( GRect rect, GTextAlignment align , GFont font ) {
+  TextLayer *newLayer = text_layer_create( rect );
+  text_layer_set_text_color( newLayer, FG_COLOR );
+  text_layer_set_background_color( newLayer, GColorClear );
+  text_layer_set_text_alignment( newLayer, align );
+  if ( font != NULL ) {
+    text_layer_set_font( newLayer, font );
+  }
+
+  return newLayer;
+}
+#endif
+
+/*
+  Bring a field's layer or background slice in line with whether it
+  shows, creating it the first time it does
+*/
+static void update_field( int i ) {
+  bool show = ( face_shown_mask() & ( 1u << i ) ) != 0;
+#ifdef FACE_CANVAS
+  if ( show && region_background[i] == NULL ) {
+    region_background[i] = gbitmap_create_as_sub_bitmap( background_image, region_rect( i ) );
+  }
+  if ( region_background[i] != NULL ) {
+    mark_region( i );
+  }
+#else
+  if ( show && field_layer[i] == NULL ) {
+    field_layer[i] = setup_text_layer( fields[i].rect, fields[i].align, fonts[fields[i].font] );
+    // under the images, like the fields created with the face
+    layer_insert_below_sibling( text_layer_get_layer( field_layer[i] ),
+                                bitmap_layer_get_layer( image_layer[0] ) );
+  }
+  if ( field_layer[i] != NULL ) {
+    if ( show ) {
+      text_layer_set_font( field_layer[i], fonts[fields[i].font] );
+      text_layer_set_text( field_layer[i], field_text[i] );
+    }
+    layer_set_hidden( text_layer_get_layer( field_layer[i] ), !show );
+  }
+#endif
+}
+
+void face_init( Window *window, AppTimerCallback first_frame ) {
+  Layer *window_layer = window_get_root_layer( window );
+  int i;
+#ifdef FACE_PROFILE
+  int heap_before = heap_bytes_used();
+
+  probe_first = layer_create( layer_get_frame( window_layer ) );
+  layer_set_update_proc( probe_first, probe_first_update );
+  layer_add_child( window_layer, probe_first );
+#endif
+
+  // Background image
+  background_image = gbitmap_create_with_resource( RESOURCE_ID_BG_IMAGE );
+
+  // Load the fonts of the time and date
+  for ( i = 0; i < FONT_DEFERRED; i++ ) {
+    fonts[i] = fonts_load_custom_font( resource_get_handle( FONT_RESOURCES[i] ) );
+  }
+  fonts[FONT_SYSTEM] = fonts_get_system_font( FONT_KEY_GOTHIC_14_BOLD );
+
+  for ( i = 0; i < FIELD_COUNT; i++ ) {
+    if ( !fields[i].hidden ) {
+      visible |= 1u << i;
+    }
+    if ( fonts[fields[i].font] != NULL ) {
+      ready |= 1u << i;
+    }
+  }
+
+#ifdef FACE_CANVAS
+  for ( i = 0; i < REGION_COUNT; i++ ) {
+    int j;
+    if ( i >= FIELD_COUNT || ( visible & ( 1u << i ) ) ) {
+      region_background[i] = gbitmap_create_as_sub_bitmap( background_image, region_rect( i ) );
+    }
+    overlap[i] = 0;
+    for ( j = 0; j < REGION_COUNT; j++ ) {
+      if ( rects_overlap( region_rect( i ), region_rect( j ) ) ) {
+        overlap[i] |= 1u << j;
+      }
+    }
+  }
+  dirty = REGION_ALL;
+
+  window_set_background_color( window, GColorClear );
+  canvas_layer = layer_create( layer_get_frame( window_layer ) );
+  layer_set_update_proc( canvas_layer, canvas_update );
+  layer_add_child( window_layer, canvas_layer );
+#else
+  background_layer = bitmap_layer_create( layer_get_frame( window_layer ) );
+  bitmap_layer_set_bitmap( background_layer, background_image );
+  layer_add_child( window_layer, bitmap_layer_get_layer( background_layer ) );
+
+  // hidden ones get their layer when first shown; those waiting for a
+  // font get it now, so they keep their place in the drawing order
+  for ( i = 0; i < FIELD_COUNT; i++ ) {
+    if ( visible & ( 1u << i ) ) {
+      field_layer[i] = setup_text_layer( fields[i].rect, fields[i].align, fonts[fields[i].font] );
+      layer_set_hidden( text_layer_get_layer( field_layer[i] ), !( ready & ( 1u << i ) ) );
+      layer_add_child( window_layer, text_layer_get_layer( field_layer[i] ) );
+    }
+  }
+
+  for ( i = 0; i < IMAGE_COUNT; i++ ) {
+    image_layer[i] = bitmap_layer_create( image_rect[i] );
+    layer_add_child( window_layer, bitmap_layer_get_layer( image_layer[i] ) );
+  }
+#endif
+
+  first_frame_callback = first_frame;
+  first_frame_layer = layer_create( GRect( 0, 0, 1, 1 ) );
+  layer_set_update_proc( first_frame_layer, first_frame_update );
+  layer_add_child( window_layer, first_frame_layer );
+
+#ifdef FACE_PROFILE
+  probe_last = layer_create( layer_get_frame( window_layer ) );
+  layer_set_update_proc( probe_last, probe_last_update );
+  layer_add_child( window_layer, probe_last );
+
+#ifdef FACE_CANVAS
+  APP_LOG( APP_LOG_LEVEL_INFO, "face: canvas mode, %d bytes heap", heap_bytes_used() - heap_before );
+#else
+  APP_LOG( APP_LOG_LEVEL_INFO, "face: layer mode, %d bytes heap", heap_bytes_used() - heap_before );
+#endif
+#endif
+}
+
+/*
+  Load the fonts left out of face_init and show the fields that use them
+*/
+void face_init_deferred( void ) {
+  int i;
+
+  layer_remove_from_parent( first_frame_layer );
+  layer_destroy( first_frame_layer );
+  first_frame_layer = NULL;
+
+  for ( i = FONT_DEFERRED; i < FONT_COUNT; i++ ) {
+    fonts[i] = fonts_load_custom_font( resource_get_handle( FONT_RESOURCES[i] ) );
+  }
+
+  face_begin();
+  for ( i = 0; i < FIELD_COUNT; i++ ) {
+    if ( !( ready & ( 1u << i ) ) ) {
+      ready |= 1u << i;
+      update_field( i );
+    }
+  }
+  face_commit();
+}
+
+void face_deinit( void ) {
+  int i;
+#ifdef FACE_CANVAS
+  layer_destroy( canvas_layer );
+  for ( i = 0; i < REGION_COUNT; i++ ) {
+    if ( region_background[i] != NULL ) {
+      gbitmap_destroy( region_background[i] );
+    }
+  }
+#else
+  for ( i = 0; i < IMAGE_COUNT; i++ ) {
+    bitmap_layer_destroy( image_layer[i] );
+  }
+  for ( i = 0; i < FIELD_COUNT; i++ ) {
+    if ( field_layer[i] != NULL ) {
+      text_layer_destroy( field_layer[i] );
+    }
+  }
+  bitmap_layer_destroy( background_layer );
+#endif
+#ifdef FACE_PROFILE
+  layer_destroy( probe_first );
+  layer_destroy( probe_last );
+#endif
+  if ( first_frame_layer != NULL ) {
+    layer_destroy( first_frame_layer );
+  }
+  gbitmap_destroy( background_image );
+  for ( i = 0; i < FONT_COUNT; i++ ) {
+    if ( fonts[i] != NULL ) {
+      fonts_unload_custom_font( fonts[i] );
+    }
+  }
+}
+
+void face_begin( void ) {
+#ifdef FACE_CANVAS
+  batching = true;
+#endif
+}
+
+void face_commit( void ) {
+#ifdef FACE_CANVAS
+  batching = false;
+  if ( dirty ) {
+    layer_mark_dirty( canvas_layer );
+  }
+#endif
+}
+
+void face_appear( void ) {
+#ifdef FACE_CANVAS
+  // whatever covered the window left its pixels in the frame buffer
+  dirty = REGION_ALL;
+  if ( canvas_layer != NULL ) {
+    layer_mark_dirty( canvas_layer );
+  }
+#endif
+}
+
+void face_set_text( FaceField field, const char *text ) {
+  field_text[field] = text;
+  if ( !( face_shown_mask() & ( 1u << field ) ) ) {
+    return;
+  }
+#ifdef FACE_CANVAS
+  mark_region( field );
+#else
+  text_layer_set_text( field_layer[field], text );
+#endif
+}
+
+// The bitmap stays owned by the caller
+void face_set_image( FaceImage which, GBitmap *bitmap ) {
+  image[which] = bitmap;
+#ifdef FACE_CANVAS
+  mark_region( REGION_IMAGE( which ) );
+#else
+  bitmap_layer_set_bitmap( image_layer[which], bitmap );
+#endif
+}
+
+void face_set_shown( FaceField field, bool shown ) {
+  if ( ( ( visible >> field ) & 1 ) == shown ) {
+    return;
+  }
+  visible ^= 1u << field;
+  update_field( field );
+}
+
+uint32_t face_shown_mask( void ) {
+  return visible & ready;
+}
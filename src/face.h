@@ -0,0 +1,67 @@
+#ifndef FACE_H
+#define FACE_H
+
+#include <pebble.h>
+
+/*
+ * Everything the face shows, drawn either as one TextLayer per field
+ * or, with FACE_CANVAS defined in config.h, by a single Layer whose
+ * update_proc paints the fields from the table in face.c.  The canvas
+ * only repaints the fields set since its last frame, so the per-second
+ * update touches the seconds and whatever overlaps them.
+ *
+ * A field shows once its font is loaded unless it is hidden, from the
+ * start (the fields table in face.c) or with face_set_shown.  A field
+ * that never shows gets no layer (layer mode) and no background slice
+ * (canvas mode).
+ */
+typedef enum {
+  FIELD_TIME,
+  FIELD_AMPM,
+  FIELD_TEMP,
+  FIELD_COND,
+  FIELD_UPDATED,
+  FIELD_BAR,
+  FIELD_SUNRISE,
+  FIELD_SUNSET,
+  FIELD_MOONRISE,
+  FIELD_MOONSET,
+  FIELD_DAY,
+  FIELD_SECS,
+  FIELD_DATE,
+  FIELD_MOON,
+  FIELD_MOONP,
+  FIELD_ERROR,
+  FIELD_COUNT
+} FaceField;
+
+// Bitmaps drawn over the fields, in this order
+typedef enum {
+  IMAGE_WEATHER,
+  IMAGE_BATTERY,
+  IMAGE_BLUETOOTH,
+  IMAGE_COUNT
+} FaceImage;
+
+// Loads what the time and date need; first_frame runs (from an app_timer)
+// once the first frame has been drawn, and should call face_init_deferred
+void face_init( Window *window, AppTimerCallback first_frame );
+void face_init_deferred( void );
+void face_deinit( void );
+
+// Group several updates into one invalidation (canvas mode)
+void face_begin( void );
+void face_commit( void );
+
+// The window is on screen again: its next frame repaints everything
+void face_appear( void );
+
+// text must stay valid until it is replaced
+void face_set_text( FaceField field, const char *text );
+void face_set_image( FaceImage image, GBitmap *bitmap );
+
+void face_set_shown( FaceField field, bool shown );
+// Fields on screen now, bit per FaceField
+uint32_t face_shown_mask( void );
+
+#endif // FACE_H
@@ -1,29 +1,107 @@
+// Packed weather message, decoded by weather_decode() in src/weather.c:
+// version, icon, int16 temp, uint32 pressure*100 in the server's unit
+// (inHg or hPa), uint32 local epoch seconds of the reading (0 = never),
+// condition length + text.
+var WEATHER_VERSION = 2;
+var WEATHER_BAR_MAX = 0xffffffff;
+var WEATHER_COND_MAX = 31;
+
+function encodeWeather(temp, icon, bar, time, cond) {
+  var bytes = [WEATHER_VERSION, icon & 0xff,
+               temp & 0xff, (temp >> 8) & 0xff,
+               bar & 0xff, (bar >> 8) & 0xff, (bar >> 16) & 0xff, (bar >>> 24) & 0xff,
+               time & 0xff, (time >> 8) & 0xff, (time >> 16) & 0xff, (time >>> 24) & 0xff];
+  // UTF-8, cut back to whole characters that fit
+  var text = String(cond);
+  var utf8 = unescape(encodeURIComponent(text));
+  while (utf8.length > WEATHER_COND_MAX) {
+    text = text.substring(0, text.length - 1);
+    utf8 = unescape(encodeURIComponent(text));
+  }
+  bytes.push(utf8.length);
+  for (var i = 0; i < utf8.length; i++) {
+    bytes.push(utf8.charCodeAt(i));
+  }
+  return bytes;
+}
+
+// Packed location message, decoded by location_decode() in src/location.c:
+// version, int16 lat and lon in 1/100 degree (east positive), int16 UTC
+// offset in minutes.
+var LOCATION_VERSION = 1;
+
+function encodeLocation(latitude, longitude) {
+  var lat = Math.round(latitude * 100);
+  var lon = Math.round(longitude * 100);
+  var offset = -new Date().getTimezoneOffset();
+  return [LOCATION_VERSION,
+          lat & 0xff, (lat >> 8) & 0xff,
+          lon & 0xff, (lon >> 8) & 0xff,
+          offset & 0xff, (offset >> 8) & 0xff];
+}
+
+// Where the last fix was; it rides along with the weather
+var lastLocation = null;
+
+// The watch clock runs on local time, so timestamps are local epoch seconds
+function localEpoch() {
+  var now = new Date();
+  return Math.floor(now.getTime() / 1000) - now.getTimezoneOffset() * 60;
+}
+
+function sendWeather(temp, icon, bar, time, cond) {
+  var hundredths = Math.round(parseFloat(bar) * 100) || 0;
+  var message = {
+    "weather": encodeWeather(Math.round(parseFloat(temp)) || 0,
+                             parseInt(icon, 10) || 0,
+                             Math.min(Math.max(hundredths, 0), WEATHER_BAR_MAX),
+                             time, cond)
+  };
+  if (lastLocation) {
+    message.location = lastLocation;
+  }
+  Pebble.sendAppMessage(message);
+}
+
+// A fetch is under way; a refresh request from the watch that comes
+// meanwhile is answered by it
+var fetching = false;
+var FETCH_TIMEOUT_MS = 30000;
+
+function fetchDone() {
+  fetching = false;
+}
+
 function getWeatherFromLatLong(latitude, longitude) {
   var response;
   var req = new XMLHttpRequest();
   var url = "http://viwebworks.net/weatherpage.aspx?lat=" + latitude + "&lon=" + longitude;
   req.open('GET', url, true);
+  req.timeout = FETCH_TIMEOUT_MS;
   req.onload = function(e) {
     if (req.readyState == 4) {
+      fetchDone();
       if (req.status == 200) {
         response = JSON.parse(req.responseText);
         //Pebble.showSimpleNotificationOnPebble("JSON", response);
         if (response && response.list && response.list.length > 0) {
             var weatherResult = response.list[0];
-            Pebble.sendAppMessage({
-            "temp":weatherResult.temp,
-            "icon":weatherResult.icon,
-            "bar":weatherResult.bar,
-            "updated":weatherResult.now,
-            "cond":weatherResult.image
-          });
+            sendWeather(weatherResult.temp, weatherResult.icon, weatherResult.bar,
+                        localEpoch(), weatherResult.image);
         }
       }
     }
   }
+  req.onerror = fetchDone;
+  req.ontimeout = fetchDone;
+  req.onabort = fetchDone;
   req.send(null);
 }
 function updateWeather() {
+  if (fetching) {
+    return;
+  }
+  fetching = true;
   window.navigator.geolocation.getCurrentPosition(locationSuccess,
                                                     locationError,
                                                     locationOptions);
@@ -33,20 +111,24 @@ var locationOptions = { "timeout": 15000, "maximumAge": 60000 };
 
 function locationSuccess(pos) {
   var coordinates = pos.coords;
+  lastLocation = encodeLocation(coordinates.latitude, coordinates.longitude);
   getWeatherFromLatLong(coordinates.latitude, coordinates.longitude);
 }
 
 function locationError(err) {
-  Pebble.sendAppMessage({
-    "temp":err.code,
-    "icon":"13",
-    "bar":"heh",
-    "updated":"never",
-    "cond":err.message
-  });
+  fetchDone();
+  sendWeather(err.code, 13, 0, 0, err.message);
 }
+// The watch shows its saved weather at launch and asks for a fetch
+// (the "refresh" key) only when that is stale; it keeps asking until
+// this side is running and answers
+Pebble.addEventListener("appmessage", function(e) {
+  if (e.payload.refresh !== undefined) {
+    updateWeather();
+  }
+});
+
 Pebble.addEventListener("ready", function(e) {
-  updateWeather();
   setInterval(function() {
     updateWeather();
   }, 900000);
@@ -0,0 +1,17 @@
+#ifndef KEYS_H
+#define KEYS_H
+
+// AppMessage keys, as in appKeys in appinfo.json
+enum MessageKey {
+  WEATHER_KEY = 0x5,  // packed Weather, see weather.h
+  REFRESH_KEY = 0x6,  // watch -> phone: fetch weather now
+  LOCATION_KEY = 0x7  // packed Location, see location.h
+};
+
+enum PersistKey {
+  PERSIST_WEATHER = 1,  // last WEATHER_KEY payload, as received
+  PERSIST_LOCATION = 2, // last LOCATION_KEY payload that moved to another cell
+  PERSIST_ALMANAC = 3   // days worked out for places the table does not cover
+};
+
+#endif // KEYS_H
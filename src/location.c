@@ -0,0 +1,40 @@
+#include "location.h"
+
+int location_decode(const uint8_t* data, int length, Location* loc)
+{
+    if (length < LOCATION_SIZE || data[0] != LOCATION_VERSION) return 0;
+    loc->lat = (int16_t)(data[1] | (data[2] << 8));
+    loc->lon = (int16_t)(data[3] | (data[4] << 8));
+    loc->utc_offset = (int16_t)(data[5] | (data[6] << 8));
+    return 1;
+}
+
+int location_cell(int centi)
+{
+    // rounds down for negative coordinates too
+    return centi >= 0 ? centi / LOCATION_CELL : -((LOCATION_CELL - 1 - centi) / LOCATION_CELL);
+}
+
+int location_same_cell(const Location* a, const Location* b)
+{
+    return location_cell(a->lat) == location_cell(b->lat) &&
+           location_cell(a->lon) == location_cell(b->lon) && a->utc_offset == b->utc_offset;
+}
+
+static int apart(int a, int b)
+{
+    return (a > b ? a - b : b - a) > LOCATION_CELL / 2;
+}
+
+int location_moved(const Location* a, const Location* b)
+{
+    if (a->utc_offset != b->utc_offset) return 1;
+    if (location_same_cell(a, b)) return 0;
+    return apart(a->lat, b->lat) || apart(a->lon, b->lon);
+}
+
+void location_cell_centre(const Location* loc, float* lat, float* lon)
+{
+    *lat = (location_cell(loc->lat) * LOCATION_CELL + LOCATION_CELL / 2.0f) / 100.0f;
+    *lon = (location_cell(loc->lon) * LOCATION_CELL + LOCATION_CELL / 2.0f) / 100.0f;
+}
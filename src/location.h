@@ -0,0 +1,45 @@
+#ifndef LOCATION_H
+#define LOCATION_H
+
+#include <stdint.h>
+
+/*
+ * Where the watch is, as the phone sends it: one byte array under
+ * LOCATION_KEY, encoded by encodeLocation() in pebble-js-app.js.
+ *
+ * Layout, all little-endian:
+ *   uint8  version (LOCATION_VERSION)
+ *   int16  latitude, longitude in 1/100 degree, east positive
+ *   int16  UTC offset in minutes, local = UTC + offset
+ *
+ * Rise and set times are worked out once per cell of LOCATION_CELL
+ * 1/100 degree (0.1 degree, under half a minute of sunrise), for its
+ * centre, so GPS jitter inside a cell changes nothing.
+ */
+#define LOCATION_VERSION  1
+#define LOCATION_SIZE     7
+#define LOCATION_CELL     10
+
+typedef struct {
+    int16_t lat, lon;           // 1/100 degree
+    int16_t utc_offset;         // minutes
+} Location;
+
+// false if the payload is not a version we understand; loc is untouched then
+int location_decode(const uint8_t* data, int length, Location* loc);
+
+// cell index of a 1/100 degree coordinate
+int location_cell(int centi);
+
+// same cell and UTC offset
+int location_same_cell(const Location* a, const Location* b);
+
+// Worth moving the almanac from b to a: another UTC offset, or another
+// cell and more than half a cell away, so a fix wobbling across a cell
+// edge stays put
+int location_moved(const Location* a, const Location* b);
+
+// centre of loc's cell, degrees
+void location_cell_centre(const Location* loc, float* lat, float* lon);
+
+#endif // LOCATION_H
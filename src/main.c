@@ -3,68 +3,29 @@
 #include "config.h"
 #include "pbl-math.h"
 #include "sunmoon.h"
+#include "almanac.h"
+#include "atlas.h"
 #include "util.h"
+#include "face.h"
+#include "weather.h"
+#include "profile.h"
+#include "timefmt.h"
+#include "sched.h"
+#include "complication.h"
+#include "location.h"
+#include "keys.h"
 
-#define ConstantGRect(x, y, w, h) {{(x), (y)}, {(w), (h)}}
 #define VIBHOUR //Vibrate at the top of the hour
-#define FG_COLOR GColorWhite
-
-enum WeatherKey {
-  TEMP_KEY = 0x0,
-  IMAGE_KEY = 0x1,
-  BAR_KEY = 0x2,
-  TIME_KEY = 0x3,
-  COND_KEY = 0x4
-};
+
+// Refused refresh requests are retried, doubling from the first delay
+// up to the longest, until the phone answers
+#define REFRESH_RETRY_MS     2000
+#define REFRESH_RETRY_MAX_MS 60000
+// Seconds between saves of weather whose fields did not change
+#define WEATHER_SAVE     3600
  
 static Window *window;
-static GBitmap     *background_image = NULL;
-static GBitmap     *battery_image = NULL;
-static GBitmap     *bluetooth_image = NULL;
-static GBitmap     *icon_image = NULL;
-static BitmapLayer *background_layer;
-static BitmapLayer *battery_layer;
-static BitmapLayer *bluetooth_layer;
-static BitmapLayer *icon_layer;
-static TextLayer *temp_layer;
-static TextLayer *bar_layer;
-static TextLayer *sunrise_layer;
-static TextLayer *sunset_layer;
-static TextLayer *error_layer;
-static TextLayer *updated_layer;
-static TextLayer *conditions_layer;
-static TextLayer *day_layer;
-static TextLayer *date_layer;
-static TextLayer *time_layer;
-static TextLayer *secs_layer;
-static TextLayer *ampm_layer;
-static TextLayer *moonPercent_layer;
-static GFont *font_date;
-static GFont *font_time;
-static GFont *font_temp;
-static GFont *font_cond;
-static GFont *font_times;
-static GFont *font_moon;
-
-static AppSync sync;
-static uint8_t sync_buffer[124];
-// Define layer rectangles (x, y, width, height)
-GRect TEMP_RECT  = ConstantGRect(5, 0, 75, 26);
-GRect BAR_RECT  = ConstantGRect(44, 0, 100, 26);
-GRect UPDATED_RECT  = ConstantGRect(2, 53, 75, 20);
-GRect COND_RECT  = ConstantGRect(44, 53, 99, 20);
-GRect SRISE_RECT  = ConstantGRect(5, 145, 75, 20);
-GRect SSET_RECT  = ConstantGRect(39, 145, 100, 20);
-GRect DAY_RECT    = ConstantGRect(5, 117, 144, 33);
-GRect TIME_RECT  = ConstantGRect(5, 66, 114, 60);
-GRect SECS_RECT  = ConstantGRect(119, 70, 144-116, 28);
-GRect AMPM_RECT  = ConstantGRect(116, 89, 144-116, 28);
-GRect DATE_RECT  = ConstantGRect(1, 117, 144-1, 168-118);
-GRect MOON_RECT    = ConstantGRect(0, 142, 144, 168-142);
-GRect ERR_RECT    = ConstantGRect(0, 35, 144, 26);
-GRect BATT_RECT  = ConstantGRect( 123,  94,  17,   9 );
-GRect BT_RECT    = ConstantGRect(   4,  94,  17,   9 );
-GRect ICON_RECT    = ConstantGRect(35, 0, 70, 70);
+
 
 // Define placeholders for time and date
 static char time_text[] = "00:00";
@@ -73,54 +34,34 @@ static char ampm_text[] = "AM";
 static char date_text[] = "Xxxxxxxxx 00";
 static char day_text[] = "Xxxxxxxxx";
 
-// Work around to handle initial display for minutes to work when testing units_changed
-static bool first_cycle = true;
-static const uint32_t WEATHER_ICONS[] = {
-        RESOURCE_ID_ICON_CHANCEFLURRIES_BLACK,//0
-        RESOURCE_ID_ICON_CHANCESNOW_BLACK,//1
-        RESOURCE_ID_ICON_CHANCETSTORMS_BLACK,//2
-        RESOURCE_ID_ICON_CLOUDY_BLACK,//3
-        RESOURCE_ID_ICON_FLURRIES_BLACK,//4
-        RESOURCE_ID_ICON_NT_CHANCEFLURRIES_BLACK,//5
-        RESOURCE_ID_ICON_NT_CHANCESNOW_BLACK,//6
-        RESOURCE_ID_ICON_NT_PARTLYCLOUDY_BLACK,//7
-        RESOURCE_ID_ICON_NT_SUNNY_BLACK,//8
-        RESOURCE_ID_ICON_PARTLYCLOUDY_BLACK,//9
-        RESOURCE_ID_ICON_RAIN_BLACK,//10
-        RESOURCE_ID_ICON_SNOW_BLACK,//11
-        RESOURCE_ID_ICON_SUNNY_BLACK,//12
-        RESOURCE_ID_ICON_UNKNOWN_BLACK,//13
-        RESOURCE_ID_ICON_FOG_BLACK//14
+#ifdef STARTUP_PROFILE
+static uint32_t startup_start, startup_critical;
+#endif
+
+// Tick mode: second ticks for a while after a wrist tap, minute ticks otherwise
+static bool seconds_on = true;
+static bool battery_low = false;
+static time_t last_tap;
+
+#ifdef TICK_PROFILE
+// Wakeups and time spent in minute [0] and second [1] mode this hour
+static uint32_t mode_ticks[2];
+static uint32_t mode_seconds[2];
+static time_t mode_since;
+static uint32_t ticks_since;
+#endif
+
+// What the scheduler runs (sched.h), in this order within a wakeup
+enum Job {
+  JOB_DAY,
+  JOB_MINUTE,
+  JOB_SECONDS,    // enabled while seconds show
+  JOB_HOUR,
+  JOB_IDLE,       // back to minute ticks once the wrist is idle
+  JOB_WEATHER,    // ask the phone when the weather is stale
+  JOB_COUNT
 };
 
-/*
-  Setup new TextLayer
-*/
-static TextLayer * setup_text_layer( GRect rect, GTextAlignment align , GFont font ) {
-  TextLayer *newLayer = text_layer_create( rect );
-  text_layer_set_text_color( newLayer, FG_COLOR );
-  text_layer_set_background_color( newLayer, GColorClear );
-  text_layer_set_text_alignment( newLayer, align );
-  text_layer_set_font( newLayer, font );
-
-  return newLayer;
-}
-static long myAtol(const char *s) {
-    const char *p = s, *q;
-    long n = 0;
-    int sign = 1, k = 1;
-    //DEBUG("myAtol '%s'", s)
-    if (p != NULL) {
-        if (*p != '\0') {
-            if ((*p == '+') || (*p == '-')) {
-                if (*p++ == '-') sign = -1;
-            }
-            for (q = p; (*p != '\0'); p++);
-            for (--p; p >= q; --p, k *= 10) n += (*p - '0') * k;
-        }
-    }
-    return n * sign;
-}
 /*Convert decimal hours, into hours and minutes with rounding*/
 int hours(float time)
 {
@@ -136,19 +77,7 @@ int mins(float time)
 //return julian day number for time
 int tm2jd(struct tm *time)
 {
-    int y,m;
-    y = time->tm_year + 1900;
-    m = time->tm_mon + 1;
-    return time->tm_mday-32075+1461*(y+4800+(m-14)/12)/4+367*(m-2-(m-14)/12*12)/12-3*((y+4900+(m-14)/12)/100)/4;
-}
-
-float moon_phase(int jdn)
-{
-    double jd;
-    jd = jdn-2451550.1;
-    jd /= 29.530588853;
-    jd -= (int)jd;
-    return jd;
+    return jdn(time->tm_year + 1900, time->tm_mon + 1, time->tm_mday);
 }
 
 //If 12 hour time, subtract 12 from hr if hr > 12
@@ -157,7 +86,7 @@ char* thr(float time, char ap)
     static char fmttime[] = "00:00A";
     int h = hours(time);
     int m = mins(time);
-    if (clock_is_24h_style()) {
+    if (timefmt_is_24h()) {
         mini_snprintf(fmttime, sizeof(fmttime), "%d:%02d",h,m);
     } else {
         if (h > 11) {
@@ -177,7 +106,7 @@ char* mthr(float time1, float time2, char* inject)
     int m1 = mins(time1);
     int h2 = hours(time2);
     int m2 = mins(time2);
-    if (clock_is_24h_style()) {
+    if (timefmt_is_24h()) {
         mini_snprintf(fmttime, sizeof(fmttime), "%d:%02d%s %d:%02d",h1,m1,inject,h2,m2);
 	} else {
         if (h1 > 11 && h2 > 11) {
@@ -202,118 +131,362 @@ char* mthr(float time1, float time2, char* inject)
 }
 /*
   Handle bluetooth events
-
+*/
 void handle_bluetooth( bool connected ) {
-  if ( bluetooth_image != NULL ) {
-    gbitmap_destroy( bluetooth_image );
-  }
+  static int shown = -1;
 
-  if ( connected ) {
-    bluetooth_image = gbitmap_create_with_resource( RESOURCE_ID_IMAGE_BLUETOOTH );
-  } else {
-    bluetooth_image = gbitmap_create_with_resource( RESOURCE_ID_IMAGE_NO_BLUETOOTH );
+  if ( connected == shown ) {
+    return;
+  }
+  if ( !connected && shown != -1 ) {
     vibes_short_pulse();
   }
-
-  bitmap_layer_set_bitmap( bluetooth_layer, bluetooth_image );
+  shown = connected;
+  face_set_image( IMAGE_BLUETOOTH, atlas_status( connected ? ATLAS_BT_ON : ATLAS_BT_OFF ) );
 }
-*/
 
 /*
   Handle battery events
 
+  A low battery also shortens the time seconds stay on after a tap (see
+  seconds_window)
+*/
 void handle_battery( BatteryChargeState charge_state ) {
-  if ( battery_image != NULL ) {
-    gbitmap_destroy( battery_image );
+  static int shown = -1;
+  int glyph;
+  bool low = !charge_state.is_charging && charge_state.charge_percent < LOW_BATTERY;
+
+  if ( low != battery_low ) {
+    battery_low = low;
+    // the idle deadline reads seconds_window
+    sched_replan();
   }
 
   if ( charge_state.is_charging ) {
+    glyph = ATLAS_BATT_CHARGING;
+  } else if ( charge_state.charge_percent <= 20 ) {
+    glyph = ATLAS_BATT_000_020;
+  } else if ( charge_state.charge_percent <= 40 ) {
+    glyph = ATLAS_BATT_020_040;
+  } else if ( charge_state.charge_percent <= 60 ) {
+    glyph = ATLAS_BATT_040_060;
+  } else if ( charge_state.charge_percent <= 80 ) {
+    glyph = ATLAS_BATT_060_080;
+  } else {
+    glyph = ATLAS_BATT_080_100;
+  }
+  if ( glyph != shown ) {
+    shown = glyph;
+    face_set_image( IMAGE_BATTERY, atlas_status( glyph ) );
+  }
+}
 
-    battery_image = gbitmap_create_with_resource( RESOURCE_ID_IMAGE_BATT_CHARGING );
+// The weather on screen, which the weather fields are produced from
+static Weather weather;
+static bool weather_valid = false;
+// Its time, local epoch seconds, 0 = never
+static time_t weather_time;
 
-  } else {
+static const char* produce_temp(struct tm* now)
+{
+    static char temp_text[] = "-32768\xc2\xb0";
+    mini_snprintf(temp_text, sizeof(temp_text), "%d\xc2\xb0", weather.temp);
+    return temp_text;
+}
 
-    switch ( charge_state.charge_percent ) {
-      case 0 ... 20:
-        battery_image = gbitmap_create_with_resource( RESOURCE_ID_IMAGE_BATT_000_020 );
-        break;
-      case 21 ... 40:
-        battery_image = gbitmap_create_with_resource( RESOURCE_ID_IMAGE_BATT_020_040 );
-        break;
-      case 41 ... 60:
-        battery_image = gbitmap_create_with_resource( RESOURCE_ID_IMAGE_BATT_040_060 );
-        break;
-      case 61 ... 80:
-        battery_image = gbitmap_create_with_resource( RESOURCE_ID_IMAGE_BATT_060_080 );
-        break;
-      case 81 ... 100:
-        battery_image = gbitmap_create_with_resource( RESOURCE_ID_IMAGE_BATT_080_100 );
-        break;
-      }
+static const char* produce_bar(struct tm* now)
+{
+    static char bar_text[] = "42949672.95";
+    mini_snprintf(bar_text, sizeof(bar_text), "%d.%02d", (int)(weather.bar / 100), (int)(weather.bar % 100));
+    return bar_text;
+}
 
-  }
+static const char* produce_cond(struct tm* now)
+{
+    return weather.cond;
+}
 
-  bitmap_layer_set_bitmap( battery_layer, battery_image );
+// How old the weather is; changes at most once a minute
+static const char* produce_age(struct tm* now)
+{
+    static char age_text[] = "99999m ago";
+    char text[sizeof(age_text)];
+    int age = (time(NULL) - weather_time) / 60;
+
+    if (weather_time == 0) {
+        mini_snprintf(text, sizeof(text), "never");
+    } else if (age < 1) {
+        mini_snprintf(text, sizeof(text), "just now");
+    } else if (age < 60) {
+        mini_snprintf(text, sizeof(text), "%dm ago", age);
+    } else if (age < 48 * 60) {
+        mini_snprintf(text, sizeof(text), "%dh ago", age / 60);
+    } else {
+        mini_snprintf(text, sizeof(text), "%dd ago", age / (24 * 60));
+    }
+    if (strcmp(text, age_text) == 0) {
+        return NULL;
+    }
+    strcpy(age_text, text);
+    return age_text;
 }
+
+// Show the fields of a decoded weather report that differ from what is
+// on screen, as one face update; true if any did
+static bool show_weather(const Weather* w)
+{
+    bool icon = !weather_valid || w->icon != weather.icon;
+    bool temp = !weather_valid || w->temp != weather.temp;
+    bool bar = !weather_valid || w->bar != weather.bar;
+    bool cond = !weather_valid || strcmp(w->cond, weather.cond) != 0;
+
+    weather = *w;
+    weather_valid = true;
+    weather_time = w->time;
+
+    face_begin();
+    // the atlas holds every icon; only an index change needs a redraw
+    if (icon) {
+        face_set_image(IMAGE_WEATHER, atlas_icon(w->icon));
+    }
+    if (temp) {
+        complication_refresh(FIELD_TEMP);
+    }
+    if (bar) {
+        complication_refresh(FIELD_BAR);
+    }
+    if (cond) {
+        complication_refresh(FIELD_COND);
+    }
+    complication_refresh(FIELD_UPDATED);
+    face_commit();
+    return icon || temp || bar || cond;
+}
+
+/*
+  Move the almanac to another location cell; the rise, set and moon
+  fields are worked out again on the spot
 */
+static int almanac_jd;
+static const FaceField almanac_fields[] = {
+    FIELD_SUNRISE, FIELD_SUNSET, FIELD_MOONRISE, FIELD_MOONSET, FIELD_MOON, FIELD_MOONP
+};
 
-void sync_tuple_changed_callback(const uint32_t key,
-                                        const Tuple* new_tuple,
-                                        const Tuple* old_tuple,
-                                        void* context) {
-
-  // App Sync keeps new_tuple in sync_buffer, so we may use it directly
-  switch (key) {
-    case IMAGE_KEY:
-      if (icon_image) {
-        gbitmap_destroy(icon_image);
-      }
-      //text_layer_set_text(error_layer, new_tuple->value->cstring);
-      //layer_mark_dirty(text_layer_get_layer(error_layer));
-      icon_image = gbitmap_create_with_resource(WEATHER_ICONS[myAtol(new_tuple->value->cstring)]);
-      bitmap_layer_set_bitmap(icon_layer, icon_image);
-      //layer_mark_dirty(bitmap_layer_get_layer(icon_layer));
-      break;
-
-    case TEMP_KEY:
-      text_layer_set_text(temp_layer, new_tuple->value->cstring);
-      //layer_mark_dirty(text_layer_get_layer(bar_layer));
-      break;
-
-    case BAR_KEY:
-      text_layer_set_text(bar_layer, new_tuple->value->cstring);
-      //layer_mark_dirty(text_layer_get_layer(bar_layer));
-      break;
-
-    case TIME_KEY:
-      text_layer_set_text(updated_layer, new_tuple->value->cstring);
-      //layer_mark_dirty(text_layer_get_layer(updated_layer));
-      break;
-
-    case COND_KEY:
-      text_layer_set_text(conditions_layer, new_tuple->value->cstring);
-      //layer_mark_dirty(text_layer_get_layer(conditions_layer));
-      break;
-  }
+static void show_location(const Location* loc)
+{
+    unsigned int i;
+
+    almanac_set_location(loc);
+    almanac_jd = 0;
+    face_begin();
+    for (i = 0; i < ARRAY_LENGTH(almanac_fields); i++) {
+        complication_refresh(almanac_fields[i]);
+    }
+    face_commit();
+}
+
+/*
+  Ask the phone for fresh weather.  Messages sent before the phone side
+  is running are refused, so a failed request is retried, backing off,
+  until weather comes in.
+*/
+static int refresh_tries;
+static time_t refresh_time;
+static AppTimer* refresh_timer;
+
+static void request_refresh(void);
+
+static void refresh_retry(void* data)
+{
+    refresh_timer = NULL;
+    request_refresh();
+}
+
+static void refresh_later(void)
+{
+    uint32_t ms = REFRESH_RETRY_MS;
+    int i;
+
+    for (i = 0; i < refresh_tries && ms < REFRESH_RETRY_MAX_MS; i++) {
+        ms *= 2;
+    }
+    if (ms > REFRESH_RETRY_MAX_MS) {
+        ms = REFRESH_RETRY_MAX_MS;
+    }
+    refresh_tries++;
+    if (refresh_timer) {
+        app_timer_cancel(refresh_timer);
+    }
+    refresh_timer = app_timer_register(ms, refresh_retry, NULL);
+}
+
+// The phone answered; nothing left to retry
+static void refresh_done(void)
+{
+    if (refresh_timer) {
+        app_timer_cancel(refresh_timer);
+        refresh_timer = NULL;
+    }
+    refresh_tries = 0;
+}
+
+static void request_refresh(void)
+{
+    DictionaryIterator* iter;
+
+    if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+        refresh_later();
+        return;
+    }
+    dict_write_uint8(iter, REFRESH_KEY, 1);
+    app_message_outbox_send();
+}
+
+// The phone sends weather every 15 minutes; ask when that has stopped
+static time_t stale_deadline(time_t now)
+{
+    time_t last = weather_time > refresh_time ? weather_time : refresh_time;
+
+    // ahead of now: the clock was set back, ask again now
+    if (last > now) {
+        return now;
+    }
+    return last + WEATHER_STALE;
+}
+
+static void refresh_stale(struct tm* now)
+{
+    refresh_time = time(NULL);
+    refresh_done();
+    request_refresh();
+}
+
+static void outbox_failed(DictionaryIterator* iter, AppMessageResult reason, void* context)
+{
+    refresh_later();
+}
+
+/*
+  Handle incoming messages, read in place from the inbox
+*/
+static void inbox_received(DictionaryIterator* iter, void* context)
+{
+    static time_t saved;
+    Tuple* tuple = dict_find(iter, WEATHER_KEY);
+    Weather weather;
+    Location loc;
+    bool changed;
+
+    if (tuple != NULL && tuple->type == TUPLE_BYTE_ARRAY &&
+        weather_decode(tuple->value->data, tuple->length, &weather)) {
+        refresh_done();
+        changed = show_weather(&weather);
+        // kept as it came, so the next launch decodes it the same way; an
+        // error (time 0) would replace the last good report, and one that
+        // only moved the age on is saved hourly to spare the flash
+        if (weather.time != 0 &&
+            (changed || weather.time < saved || weather.time - saved >= WEATHER_SAVE)) {
+            persist_write_data(PERSIST_WEATHER, tuple->value->data, tuple->length);
+            saved = weather.time;
+        }
+        sched_replan();
+    }
+
+    // moves within a cell, GPS jitter included, change nothing
+    tuple = dict_find(iter, LOCATION_KEY);
+    if (tuple != NULL && tuple->type == TUPLE_BYTE_ARRAY &&
+        location_decode(tuple->value->data, tuple->length, &loc) &&
+        location_moved(&loc, almanac_location())) {
+        show_location(&loc);
+        persist_write_data(PERSIST_LOCATION, tuple->value->data, tuple->length);
+    }
+}
+
+// Show the weather saved by the last run; false if there is none
+static bool restore_weather(void)
+{
+    uint8_t data[WEATHER_MAX_SIZE];
+    Weather weather;
+    int length = persist_read_data(PERSIST_WEATHER, data, sizeof(data));
+
+    if (length <= 0 || !weather_decode(data, length, &weather)) {
+        return false;
+    }
+    show_weather(&weather);
+    return true;
 }
 
-// Handle sunmoon stuffs
-static void handle_sunmoon(struct tm *time)
+// Where the last run was; config.h's location until the phone has said
+static void restore_location(void)
 {
+    uint8_t data[LOCATION_SIZE];
+    Location loc;
+    int length = persist_read_data(PERSIST_LOCATION, data, sizeof(data));
 
-    static char riseText[] = "00:00";
-    static char setText[] = "00:00";
+    if (length > 0 && location_decode(data, length, &loc)) {
+        almanac_set_location(&loc);
+    }
+}
+
+// Format a rise/set time, "--:--" when there is none that day
+static void format_event(char* text, unsigned int len, float time)
+{
+    if (time == 99.0) {
+        mini_snprintf(text, len, "--:--");
+    } else {
+        mini_snprintf(text, len, "%s", thr(time, 0));
+    }
+}
+
+// Today's rise, set and phase, worked out by the first field that shows them
+static const AlmanacDay* almanac_today(struct tm* time)
+{
+    static AlmanacDay day;
+    int jd = tm2jd(time);
+
+    if (jd != almanac_jd) {
+        almanac_jd = jd;
+        almanac_day(jd, &day);
+    }
+    return &day;
+}
+
+static const char* produce_sunrise(struct tm* now)
+{
+    static char text[] = "00:00";
+    format_event(text, sizeof(text), almanac_today(now)->sunrise);
+    return text;
+}
+
+static const char* produce_sunset(struct tm* now)
+{
+    static char text[] = "00:00";
+    format_event(text, sizeof(text), almanac_today(now)->sunset);
+    return text;
+}
+
+static const char* produce_moonrise(struct tm* now)
+{
+    static char text[] = "00:00";
+    format_event(text, sizeof(text), almanac_today(now)->moonrise);
+    return text;
+}
+
+static const char* produce_moonset(struct tm* now)
+{
+    static char text[] = "00:00";
+    format_event(text, sizeof(text), almanac_today(now)->moonset);
+    return text;
+}
+
+// Moon phase glyph
+static const char* produce_moon(struct tm* now)
+{
     static char moon[] = "m";
-    static char moonp[] = "-----";
-    float moonphase_number = 0.0;
-    int moonphase_letter = 0;
-    float sunrise, sunset;//, moonrise[3], moonset[3];
-    
+    int moonphase_letter = almanac_today(now)->phase;
 
-    moonphase_number = moon_phase(tm2jd(time));
-    moonphase_letter = (int)(moonphase_number*27 + 0.5);
     // correct for southern hemisphere
-    if ((moonphase_letter > 0) && (LAT < 0))
+    if ((moonphase_letter > 0) && (almanac_location()->lat < 0))
         moonphase_letter = 28 - moonphase_letter;
     // select correct font char
     if (moonphase_letter == 14) {
@@ -325,235 +498,271 @@ static void handle_sunmoon(struct tm *time)
     } else {
         moon[0] = (unsigned char)(moonphase_letter+95);
     }
-    text_layer_set_text(moonPercent_layer, moon);
-    if (moonphase_number >= 0.5) {
-        mini_snprintf(moonp,sizeof(moonp)," %d-",(int)((1-(1+pbl_cos(moonphase_number*M_PI*2))/2)*100));
-    } else {
-        mini_snprintf(moonp,sizeof(moonp)," %d+",(int)((1-(1+pbl_cos(moonphase_number*M_PI*2))/2)*100));
-    }
-    //text_layer_set_text(&moonPercent, moonp);
+    return moon;
+}
 
-    //sun rise set
-    sunmooncalc(tm2jd(time), TZ, LAT, -LON, 1, &sunrise, &sunset);
-    (sunrise == 99.0) ? mini_snprintf(riseText,sizeof(riseText),"--:--") : mini_snprintf(riseText,sizeof(riseText),"%s",thr(sunrise,0));
-    (sunset == 99.0) ? mini_snprintf(setText,sizeof(setText),"--:--") : mini_snprintf(setText,sizeof(setText),"%s",thr(sunset,0));
+// Illuminated percent, + waxing, - waning (hidden unless SHOW_MOONP)
+static const char* produce_moonp(struct tm* now)
+{
+    static char moonp[] = "-----";
+    float moonphase_number = almanac_today(now)->phase / 27.0;
+    float percent = (1-(1+pbl_cos(moonphase_number*M_PI*2))/2)*100;
 
-    text_layer_set_text(sunrise_layer, riseText);
-    text_layer_set_text(sunset_layer, setText);
+    // pbl_cos can overshoot 1 a little; %.0f would print that as -0
+    if (percent < 0) percent = 0;
+
+    mini_snprintf(moonp, sizeof(moonp), (moonphase_number >= 0.5) ? " %.0f-" : " %.0f+", percent);
+    return moonp;
+}
+
+// How long seconds stay on after the last tap
+static int seconds_window( void ) {
+  return battery_low ? TAP_SECONDS : IDLE_SECONDS;
 }
 
+#ifdef TICK_PROFILE
+static void account_mode( void ) {
+  time_t now = time( NULL );
+  uint32_t ticks = sched_stats()->ticks + sched_stats()->timers;
+  mode_seconds[seconds_on] += now - mode_since;
+  mode_ticks[seconds_on] += ticks - ticks_since;
+  mode_since = now;
+  ticks_since = ticks;
+}
+
+static void log_wakeups( void ) {
+  int mode;
+  account_mode();
+  for ( mode = 0; mode < 2; mode++ ) {
+    if ( mode_seconds[mode] > 0 ) {
+      APP_LOG( APP_LOG_LEVEL_INFO, "%s ticks: %d wakeups in %d s, %d per hour",
+               mode ? "second" : "minute", (int)mode_ticks[mode], (int)mode_seconds[mode],
+               (int)( mode_ticks[mode] * 3600 / mode_seconds[mode] ) );
+    }
+    mode_ticks[mode] = mode_seconds[mode] = 0;
+  }
+  APP_LOG( APP_LOG_LEVEL_INFO, "%d deadlines since startup shared a tick instead of a wakeup",
+           (int)sched_stats()->shared );
+}
+#endif
+
 /*
-  Handle tick events
+  Show or hide the seconds; the scheduler ticks every second only while
+  they show
 */
-void handle_tick( struct tm *tick_time, TimeUnits units_changed ) {
-  // Handle day change
-  if ( ( ( units_changed & DAY_UNIT ) == DAY_UNIT ) || first_cycle ) {
-    // Update text layer for current day
-    strftime( day_text, sizeof( day_text ), "%A", tick_time );
-    text_layer_set_text( day_layer, day_text );
-    strftime( date_text, sizeof( date_text ), "%b %e", tick_time );
-    text_layer_set_text( date_layer, date_text );
-    //add in handle day stuff for sunrise, sunset, and moon
-    handle_sunmoon(tick_time);
+static void set_tick_mode( bool seconds ) {
+  if ( seconds == seconds_on ) {
+    return;
   }
+#ifdef TICK_PROFILE
+  account_mode();
+#endif
+  seconds_on = seconds;
+  face_set_shown( FIELD_SECS, seconds );
+  sched_enable( JOB_SECONDS, seconds );
+}
 
-  // Handle time (hour and minute) change
-  if ( ( ( units_changed & MINUTE_UNIT ) == MINUTE_UNIT ) || first_cycle ) {
-    // Display hours (i.e. 18 or 06)
-    strftime( time_text, sizeof( time_text ), clock_is_24h_style() ? "%H:%M" : "%I:%M", tick_time );
+/*
+  Fields made from the time
+*/
+static const char *produce_day( struct tm *now ) {
+  timefmt_day( day_text, now );
+  return day_text;
+}
 
-    // Remove leading zero (only in 12h-mode)
-    if ( !clock_is_24h_style() && (time_text[0] == '0') ) {
-      memmove( time_text, &time_text[1], sizeof( time_text ) - 1 );
-    }
+static const char *produce_date( struct tm *now ) {
+  timefmt_date( date_text, now );
+  return date_text;
+}
+
+// Hours, i.e. 18:05, or 6:05 in 12h-mode
+static const char *produce_time( struct tm *now ) {
+  timefmt_time( time_text, now );
+  return time_text;
+}
 
-    text_layer_set_text( time_layer, time_text );
+// AM or PM, or nothing when using 24-hour style
+static const char *produce_ampm( struct tm *now ) {
+  timefmt_ampm( ampm_text, now );
+  return ampm_text;
+}
 
-    // Update AM/PM indicator (i.e. AM or PM or nothing when using 24-hour style)
-    strftime( ampm_text, sizeof( ampm_text ), clock_is_24h_style() ? "" : "%p", tick_time );
-    text_layer_set_text( ampm_layer, ampm_text );
-  }
+static const char *produce_seconds( struct tm *now ) {
+  timefmt_seconds( seconds_text, now );
+  return seconds_text;
+}
 
-  // Handle time second change
-  if ( ( ( units_changed & SECOND_UNIT ) == SECOND_UNIT ) || first_cycle ) {
-    // Display seconds
-    strftime( seconds_text, sizeof( seconds_text ), "%S", tick_time );
-    text_layer_set_text( secs_layer, seconds_text );
-  }
+// Every field, its producer and how often it changes
+static const Complication complications[FIELD_COUNT] = {
+  [FIELD_TIME]     = { MINUTE_UNIT, produce_time },
+  [FIELD_AMPM]     = { MINUTE_UNIT, produce_ampm },
+  [FIELD_TEMP]     = { 0,           produce_temp },
+  [FIELD_COND]     = { 0,           produce_cond },
+  [FIELD_UPDATED]  = { MINUTE_UNIT, produce_age },
+  [FIELD_BAR]      = { 0,           produce_bar },
+  [FIELD_SUNRISE]  = { DAY_UNIT,    produce_sunrise },
+  [FIELD_SUNSET]   = { DAY_UNIT,    produce_sunset },
+  [FIELD_MOONRISE] = { DAY_UNIT,    produce_moonrise },
+  [FIELD_MOONSET]  = { DAY_UNIT,    produce_moonset },
+  [FIELD_DAY]      = { DAY_UNIT,    produce_day },
+  [FIELD_SECS]     = { SECOND_UNIT, produce_seconds },
+  [FIELD_DATE]     = { DAY_UNIT,    produce_date },
+  [FIELD_MOON]     = { DAY_UNIT,    produce_moon },
+  [FIELD_MOONP]    = { DAY_UNIT,    produce_moonp },
+  [FIELD_ERROR]    = { 0,           NULL }
+};
 
-  // on the top of the hour
-  if (((units_changed & HOUR_UNIT) == HOUR_UNIT ) || first_cycle) {
+/*
+  Jobs
+*/
+static void day_changed( struct tm *tick_time ) {
+  complication_update( tick_time, DAY_UNIT );
+}
+
+static void minute_changed( struct tm *tick_time ) {
+  // 12/24h setting, read once a minute for everything formatted after it
+  timefmt_set_24h( clock_is_24h_style() );
+  complication_update( tick_time, MINUTE_UNIT );
+}
+
+static void second_changed( struct tm *tick_time ) {
+  complication_update( tick_time, SECOND_UNIT );
+}
+
+// on the top of the hour
+static void top_of_hour( struct tm *tick_time ) {
 #ifdef VIBHOUR
-      // vibrate once
-      vibes_short_pulse();
+  // vibrate once
+  vibes_short_pulse();
+#endif
+#ifdef TICK_PROFILE
+  log_wakeups();
+#endif
+#ifdef FIELD_PROFILE
+  complication_log_profile();
 #endif
-   }
-  // Clear
-  if ( first_cycle ) {
-    first_cycle = false;
+}
+
+static time_t idle_deadline( time_t now ) {
+  if ( !seconds_on ) {
+    return 0;
   }
+  // a tap ahead of now was before the clock was set back
+  return last_tap > now ? now : last_tap + seconds_window();
+}
+
+// Wrist idle long enough: back to minute ticks
+static void drop_seconds( struct tm *tick_time ) {
+  set_tick_mode( false );
 }
 
+static const SchedJob jobs[JOB_COUNT] = {
+  [JOB_DAY]     = { DAY_UNIT,    SCHED_NOW, 0,  day_changed },
+  [JOB_MINUTE]  = { MINUTE_UNIT, SCHED_NOW, 0,  minute_changed },
+  [JOB_SECONDS] = { SECOND_UNIT, SCHED_NOW, 0,  second_changed },
+  [JOB_HOUR]    = { HOUR_UNIT,   0,         0,  top_of_hour },
+  [JOB_IDLE]    = { 0,           0,         1,  drop_seconds, idle_deadline },
+  [JOB_WEATHER] = { 0,           SCHED_OFF, 60, refresh_stale, stale_deadline }
+};
+
 /*
-  Destroy GBitmap and BitmapLayer
+  Handle accelerometer taps: show seconds again for a while
 */
-void destroy_graphics( GBitmap *image, BitmapLayer *layer ) {
-  layer_remove_from_parent( bitmap_layer_get_layer( layer ) );
-  bitmap_layer_destroy( layer );
-  if ( image != NULL ) {
-    gbitmap_destroy( image );
-  }
+void handle_tap( AccelAxisType axis, int32_t direction ) {
+  last_tap = time( NULL );
+  set_tick_mode( true );
+  sched_replan();
+}
+
+static void window_appear( Window *window ) {
+  face_appear();
 }
 
 static void window_unload(Window *window) {
   // Unsubscribe from services
-  tick_timer_service_unsubscribe();
-  app_sync_deinit(&sync);
-  //battery_state_service_unsubscribe();
-
-  // Destroy image objects
-  destroy_graphics( background_image, background_layer );
-  destroy_graphics( battery_image, battery_layer );
-  destroy_graphics( bluetooth_image, bluetooth_layer );
-  destroy_graphics( icon_image, icon_layer );
-
-  // Destroy tex tobjects
-  text_layer_destroy( temp_layer );
-  text_layer_destroy( bar_layer );
-  text_layer_destroy( sunrise_layer );
-  text_layer_destroy( sunset_layer );
-  text_layer_destroy( error_layer );
-  text_layer_destroy( updated_layer );
-  text_layer_destroy( conditions_layer );
-  text_layer_destroy( day_layer );
-  text_layer_destroy( date_layer );
-  text_layer_destroy( time_layer );
-  text_layer_destroy( secs_layer );
-  text_layer_destroy( ampm_layer );
-  text_layer_destroy( moonPercent_layer );
-  
-  // Destroy font objects
-  fonts_unload_custom_font( font_date );
-  fonts_unload_custom_font( font_time );
-  fonts_unload_custom_font( font_temp );
-  fonts_unload_custom_font( font_cond );
-  fonts_unload_custom_font( font_times );
-  fonts_unload_custom_font( font_moon );
+  sched_stop();
+  app_message_deregister_callbacks();
+  battery_state_service_unsubscribe();
+  bluetooth_connection_service_unsubscribe();
+  accel_tap_service_unsubscribe();
+
+  face_deinit();
+  atlas_unload();
+}
+
+/*
+  Second half of the initialization, run once the first frame is up
+*/
+static void init_deferred( void *data ) {
+#ifdef STARTUP_PROFILE
+  uint32_t first_frame = profile_ms();
+#endif
+  time_t now = time(NULL);
+
+  face_init_deferred();
+  atlas_load();
+
+  // Force update for battery and bluetooth status
+  handle_battery( battery_state_service_peek() );
+  handle_bluetooth( bluetooth_connection_service_peek() );
+
+  battery_state_service_subscribe( &handle_battery );
+  bluetooth_connection_service_subscribe( &handle_bluetooth );
+  accel_tap_service_subscribe( &handle_tap );
+
+  // Setup messaging; the inbox holds one packed weather and one location tuple
+  const int inbound_size = 80;
+  const int outbound_size = 64;
+  app_message_register_inbox_received(inbox_received);
+  app_message_register_outbox_failed(outbox_failed);
+  app_message_open(inbound_size, outbound_size);
 
+  // Last run's weather right away; the phone is only asked when it is old
+  if (!restore_weather()) {
+    // unknown icon, never updated, condition "?"
+    Weather initial = { .temp = 0, .bar = 0, .icon = ATLAS_ICON_UNKNOWN, .time = 0, .cond = "?" };
+    show_weather(&initial);
+  }
+  sched_enable( JOB_WEATHER, true );
+  restore_location();
+
+  // the fields that just got their fonts, rise/set and moon among them
+  complication_update( localtime( &now ), 0 );
+
+#ifdef STARTUP_PROFILE
+  APP_LOG( APP_LOG_LEVEL_INFO, "startup: critical %d ms, first frame at %d ms, deferred %d ms",
+           (int)startup_critical, (int)( first_frame - startup_start ),
+           (int)( profile_ms() - first_frame ) );
+#endif
 }
 
 /*
-  Initialization
+  Initialization: only what the time and date need before the first frame
 */
 void handle_init( void ) {
+#ifdef STARTUP_PROFILE
+  startup_start = profile_ms();
+#endif
   window = window_create();
   window_stack_push( window, true );
   window_set_window_handlers(window, (WindowHandlers) {
+    .appear = window_appear,
     .unload = window_unload
   });
-  Layer *window_layer = window_get_root_layer( window );
-
-  // Background image
-  background_image = gbitmap_create_with_resource( RESOURCE_ID_BG_IMAGE );
-  background_layer = bitmap_layer_create( layer_get_frame( window_layer ) );
-  bitmap_layer_set_bitmap( background_layer, background_image );
-  layer_add_child( window_layer, bitmap_layer_get_layer( background_layer ) );
-
-
-  // Load fonts
-  font_date = fonts_load_custom_font( resource_get_handle( RESOURCE_ID_FONT_ROBOTO_CONDENSED_20 ) );
-  font_time = fonts_load_custom_font( resource_get_handle( RESOURCE_ID_FONT_ROBOTO_BOLD_SUBSET_41 ) );
-  font_temp = fonts_load_custom_font( resource_get_handle( RESOURCE_ID_FONT_FUTURA_TEMP_18 ) );
-  font_cond = fonts_load_custom_font( resource_get_handle( RESOURCE_ID_FONT_FUTURA_CONDITIONS_12 ) );
-  font_times = fonts_load_custom_font( resource_get_handle( RESOURCE_ID_FONT_FUTURA_TIMES_14 ) );
-  font_moon = fonts_load_custom_font( resource_get_handle( RESOURCE_ID_FONT_MOON_PHASES_SUBSET_24 ) );
-
-  // Setup time layer
-  time_layer = setup_text_layer( TIME_RECT, GTextAlignmentCenter, font_time );
-  layer_add_child( window_layer, text_layer_get_layer( time_layer ) );
-
-  // Setup AM/PM name layer
-  ampm_layer = setup_text_layer( AMPM_RECT, GTextAlignmentCenter, font_date );
-  layer_add_child( window_layer, text_layer_get_layer( ampm_layer ) );
-
-  // Setup temp layer
-  temp_layer = setup_text_layer( TEMP_RECT, GTextAlignmentLeft, font_temp );
-  layer_add_child( window_layer, text_layer_get_layer( temp_layer ) );
-
-  // Setup conditions layer
-  conditions_layer = setup_text_layer( COND_RECT, GTextAlignmentRight, font_cond );
-  layer_add_child( window_layer, text_layer_get_layer( conditions_layer ) );
-	
-  // Setup updated layer
-  updated_layer = setup_text_layer( UPDATED_RECT, GTextAlignmentLeft, font_cond );
-  layer_add_child( window_layer, text_layer_get_layer( updated_layer ) );
-
-  // Setup barometric pressure layer
-  bar_layer = setup_text_layer( BAR_RECT, GTextAlignmentRight, font_cond );
-  layer_add_child( window_layer, text_layer_get_layer( bar_layer ) );
-
-  // Setup sunrise layer
-  sunrise_layer = setup_text_layer( SRISE_RECT, GTextAlignmentLeft, font_cond );
-  layer_add_child( window_layer, text_layer_get_layer( sunrise_layer ) );
-
-  // Setup sunset layer
-  sunset_layer = setup_text_layer( SSET_RECT, GTextAlignmentRight, font_cond );
-  layer_add_child( window_layer, text_layer_get_layer( sunset_layer ) );
-	
-  // Setup day layer
-  day_layer = setup_text_layer( DAY_RECT, GTextAlignmentLeft, font_date );
-  layer_add_child( window_layer, text_layer_get_layer( day_layer ) );
-
-  // Setup seconds layer
-  secs_layer = setup_text_layer( SECS_RECT, GTextAlignmentCenter, font_date );
-  layer_add_child( window_layer, text_layer_get_layer( secs_layer ) );
-
-  // Setup date layer
-  date_layer = setup_text_layer( DATE_RECT, GTextAlignmentRight, font_date );
-  layer_add_child( window_layer, text_layer_get_layer( date_layer ) );
-
-  // Setup moon layer
-  moonPercent_layer = setup_text_layer( MOON_RECT, GTextAlignmentCenter, font_moon );
-  layer_add_child( window_layer, text_layer_get_layer( moonPercent_layer ) );
-
-  // Setup error layer
-  error_layer = setup_text_layer( ERR_RECT, GTextAlignmentLeft, fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD) );
-  layer_add_child( window_layer, text_layer_get_layer( error_layer ) );
-
-  // Setup icon layer
-  icon_layer = bitmap_layer_create(ICON_RECT);
-  layer_add_child(window_layer, bitmap_layer_get_layer(icon_layer));
-
-  // Force update for battery and bluetooth status
-  //handle_battery( battery_state_service_peek() );
-  //handle_bluetooth( bluetooth_connection_service_peek() );
-
-  //battery_state_service_subscribe( &handle_battery );
-  //bluetooth_connection_service_subscribe( &handle_bluetooth );
 
-  // Setup messaging
-  const int inbound_size = 124;
-  const int outbound_size = 64;
-  app_message_open(inbound_size, outbound_size);
+  face_init( window, init_deferred );
 
-  Tuplet initial_values[] = {
-    TupletCString(TEMP_KEY, "0"),
-    TupletInteger(IMAGE_KEY, (uint8_t) 13),
-    TupletCString(BAR_KEY, "0"),
-    TupletCString(TIME_KEY, "00:00"),
-    TupletCString(COND_KEY, "?")
-  };
-
-  app_sync_init(&sync, sync_buffer, sizeof(sync_buffer), initial_values,
-                ARRAY_LENGTH(initial_values), sync_tuple_changed_callback,
-                NULL, NULL);
-
-  // Subscribe to services
-  tick_timer_service_subscribe( SECOND_UNIT, handle_tick );
-  // Avoids a blank screen on watch start.
+  // Time and date right away; seconds show until the wrist has been idle
   time_t now = time(NULL);
-  struct tm *tick_time = localtime(&now);
-  handle_tick( tick_time, SECOND_UNIT );
+  last_tap = now;
+#ifdef TICK_PROFILE
+  mode_since = now;
+#endif
+  complication_init( complications );
+  sched_start( jobs, JOB_COUNT );
+#ifdef STARTUP_PROFILE
+  startup_critical = profile_ms() - startup_start;
+#endif
 }
 
 /*
@@ -12,148 +12,310 @@
  *      glibc snprintf():   34860 bytes     (+24092 bytes)
  * Wasting nearly 24kB of memory just for snprintf() on
  * a chip with 32kB flash is crazy. Use mini_snprintf() instead.
+ *
+ * Supported: %d %u %x %X %c %s %% and %f, with the '0' and '-' flags,
+ * a field width and, for %f, a precision (default 6, at most 9).  %f is
+ * done in integer fixed point (no libm, no float arithmetic), rounding
+ * half to even like glibc, and is exact for values below
+ * 9.2e18 / 10^precision.  NaN and infinity print as nan and inf; larger
+ * values print as inf too.  Output matches glibc snprintf for all but
+ * those (host/printf_fuzz); the return value is the number of characters
+ * actually written, not the untruncated length.
+ *
+ * "%d:%02d" and "%s", which the face formats most, take a fast path.
  */
 
 #include <string.h>
 #include <stdarg.h>
 #include "mini-printf.h"
 
-static unsigned int
-mini_strlen(const char* s)
+static const char two_digits[] =
+    "00010203040506070809" "10111213141516171819"
+    "20212223242526272829" "30313233343536373839"
+    "40414243444546474849" "50515253545556575859"
+    "60616263646566676869" "70717273747576777879"
+    "80818283848586878889" "90919293949596979899";
+
+static const unsigned long powers_of_ten[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/* Output cursor; end leaves room for the terminating NUL */
+typedef struct {
+    char* p;
+    char* end;
+} Out;
+
+static void
+out_str(Out* o, const char* s, unsigned int len)
 {
-    unsigned int len = 0;
-    while (s[len++]) /* do nothing */;
-    return --len;
+    unsigned int room = o->end - o->p;
+    if (len > room)
+        len = room;
+    memcpy(o->p, s, len);
+    o->p += len;
 }
 
-static unsigned int
-mini_itoa(int value, unsigned int radix, unsigned int uppercase,
-          char* buffer, unsigned int zero_pad)
+static void
+out_fill(Out* o, char c, int n)
 {
-    char*	pbuffer = buffer;
-    int	negative = 0;
-    unsigned int	i, len;
-
-    /* No support for unusual radixes. */
-    if (radix > 16)
-        return 0;
+    int room = o->end - o->p;
+    if (n > room)
+        n = room;
+    while (n-- > 0)
+        *(o->p++) = c;
+}
 
-    if (value < 0) {
-        negative = 1;
-        value = -value;
+/* Digits of value in radix, written back to front ending at end */
+static char*
+mini_utoa(char* end, unsigned long long value, unsigned int radix, unsigned int uppercase)
+{
+    if (radix == 10) {
+        while (value >= 100) {
+            unsigned int d = (unsigned int)(value % 100);
+            value /= 100;
+            *(--end) = two_digits[2 * d + 1];
+            *(--end) = two_digits[2 * d];
+        }
+        if (value >= 10) {
+            *(--end) = two_digits[2 * value + 1];
+            *(--end) = two_digits[2 * value];
+        } else {
+            *(--end) = '0' + (char)value;
+        }
+    } else {
+        do {
+            unsigned int digit = value % radix;
+            *(--end) = (digit < 10 ? '0' + digit : (uppercase ? 'A' : 'a') + digit - 10);
+            value /= radix;
+        } while (value > 0);
     }
+    return end;
+}
 
-    /* This builds the string back to front ... */
-    do {
-        int digit = value % radix;
-        *(pbuffer++) = (digit < 10 ? '0' + digit : (uppercase ? 'A' : 'a') + digit - 10);
-        value /= radix;
-    } while (value > 0);
+/*
+ * Fixed-point digits of |value| with prec decimals, back to front, or
+ * NULL if value * 10^prec reaches 2^63.  value is taken apart into
+ * m * 2^-k and scaled and rounded (half to even) in integers.
+ */
+static char*
+mini_ftoa(char* end, double value, unsigned int prec)
+{
+    unsigned long long bits, m, n, mid, lo, rem_hi, rem_lo, half_hi, half_lo;
+    unsigned long long scale = powers_of_ten[prec];
+    int k, j;
+    char* start;
 
-    for (i = (pbuffer - buffer); i < zero_pad; i++)
-        *(pbuffer++) = '0';
+    memcpy(&bits, &value, sizeof(bits));
+    k = (int)((bits >> 52) & 0x7ff);
+    if (k == 0x7ff)
+        return NULL;
+    m = bits & 0xfffffffffffffULL;
+    if (k == 0)
+        k = 1;
+    else
+        m |= 1ULL << 52;
+    k = 1075 - k;
 
-    if (negative)
-        *(pbuffer++) = '-';
+    if (k <= 0) {
+        /* a whole number; m * 2^-k * scale must stay below 2^63 */
+        if (-k > 10 || (m << -k) > 0x7fffffffffffffffULL / scale)
+            return NULL;
+        n = (m << -k) * scale;
+    } else if (k > 86) {
+        /* below 2^-33, too small to round up even at 9 decimals */
+        n = 0;
+    } else {
+        /* m * scale = mid * 2^32 + lo, with mid below 2^52 */
+        lo = (m & 0xffffffff) * scale;
+        mid = (m >> 32) * scale + (lo >> 32);
+        lo &= 0xffffffff;
+        if (k < 32) {
+            if (mid >> (31 + k))
+                return NULL;
+            n = mid << (32 - k) | lo >> k;
+            rem_hi = 0;
+            rem_lo = lo & ((1ULL << k) - 1);
+            half_hi = 0;
+            half_lo = 1ULL << (k - 1);
+        } else {
+            j = k - 32;
+            n = mid >> j;
+            rem_hi = mid & ((1ULL << j) - 1);
+            rem_lo = lo;
+            half_hi = j ? 1ULL << (j - 1) : 0;
+            half_lo = j ? 0 : 1ULL << 31;
+        }
+        if (rem_hi > half_hi || (rem_hi == half_hi &&
+                                 (rem_lo > half_lo || (rem_lo == half_lo && (n & 1)))))
+            n++;
+    }
 
-    *(pbuffer) = '\0';
+    if (prec == 0)
+        return mini_utoa(end, n, 10, 0);
 
-    /* ... now we reverse it (could do it recursively but will
-     * conserve the stack space) */
-    len = (pbuffer - buffer);
-    for (i = 0; i < len / 2; i++) {
-        char j = buffer[i];
-        buffer[i] = buffer[len-i-1];
-        buffer[len-i-1] = j;
-    }
+    start = mini_utoa(end, n % scale, 10, 0);
+    while ((unsigned int)(end - start) < prec)
+        *(--start) = '0';
+    *(--start) = '.';
+    return mini_utoa(start, n / scale, 10, 0);
+}
 
-    return len;
+/* Sign and digits into a field of width, padded as the flags say */
+static void
+out_field(Out* o, char sign, const char* digits, unsigned int len, int width,
+          int left, int zero)
+{
+    int pad = width - (int)len - (sign != 0);
+    if (pad > 0 && !left && !zero)
+        out_fill(o, ' ', pad);
+    if (sign)
+        out_str(o, &sign, 1);
+    if (pad > 0 && !left && zero)
+        out_fill(o, '0', pad);
+    out_str(o, digits, len);
+    if (pad > 0 && left)
+        out_fill(o, ' ', pad);
 }
 
 int
 mini_vsnprintf(char* buffer, unsigned int buffer_len, char* fmt, va_list va)
 {
-    char* pbuffer = buffer;
-    char bf[24];
-    char ch;
-
-    int _putc(char ch) {
-        if ((unsigned int)((pbuffer - buffer) + 1) >= buffer_len)
-            return 0;
-        *(pbuffer++) = ch;
-        *(pbuffer) = '\0';
-        return 1;
-    }
+    Out o;
+    char bf[48];
+    char* const bf_end = bf + sizeof(bf);
 
-    int _puts(char *s, unsigned int len) {
-        unsigned int i;
+    if (buffer_len == 0)
+        return 0;
 
-        if (buffer_len - (pbuffer - buffer) - 1 < len)
-            len = buffer_len - (pbuffer - buffer) - 1;
+    /* "%d:%02d", hours and minutes */
+    if (fmt[0] == '%' && fmt[1] == 'd' && fmt[2] == ':' && fmt[3] == '%' &&
+        fmt[4] == '0' && fmt[5] == '2' && fmt[6] == 'd' && fmt[7] == '\0' && buffer_len >= 6) {
+        va_list copy;
+        int a, b;
+        va_copy(copy, va);
+        a = va_arg(copy, int);
+        b = va_arg(copy, int);
+        va_end(copy);
+        if (a >= 0 && a < 100 && b >= 0 && b < 100) {
+            char* p = buffer;
+            if (a >= 10)
+                *(p++) = two_digits[2 * a];
+            *(p++) = two_digits[2 * a + 1];
+            *(p++) = ':';
+            *(p++) = two_digits[2 * b];
+            *(p++) = two_digits[2 * b + 1];
+            *p = '\0';
+            return p - buffer;
+        }
+    }
 
-        /* Copy to buffer */
-        for (i = 0; i < len; i++)
-            *(pbuffer++) = s[i];
-        *(pbuffer) = '\0';
+    o.p = buffer;
+    o.end = buffer + buffer_len - 1;
 
-        return len;
+    /* "%s" */
+    if (fmt[0] == '%' && fmt[1] == 's' && fmt[2] == '\0') {
+        const char* s = va_arg(va, char*);
+        out_str(&o, s, strlen(s));
+        *o.p = '\0';
+        return o.p - buffer;
     }
 
-    while ((ch=*(fmt++))) {
-        if ((unsigned int)((pbuffer - buffer) + 1) >= buffer_len)
+    while (*fmt) {
+        const char* lit = fmt;
+        int left = 0, zero = 0, width = 0, prec = -1;
+        char sign = 0, ch;
+        char* digits;
+
+        /* literal text up to the next conversion, copied in one go */
+        while (*fmt && *fmt != '%')
+            fmt++;
+        out_str(&o, lit, fmt - lit);
+        if (*fmt == '\0')
             break;
-        if (ch!='%')
-            _putc(ch);
-        else {
-            char zero_pad = 0;
-            char* ptr;
-            unsigned int len;
-
-            ch=*(fmt++);
-
-            /* Zero padding requested */
-            if (ch=='0') {
-                ch=*(fmt++);
-                if (ch == '\0')
-                    goto end;
-                if (ch >= '0' && ch <= '9')
-                    zero_pad = ch - '0';
-                ch=*(fmt++);
+        fmt++;
+
+        for (;; fmt++) {
+            if (*fmt == '-')
+                left = 1;
+            else if (*fmt == '0')
+                zero = 1;
+            else
+                break;
+        }
+        while (*fmt >= '0' && *fmt <= '9')
+            width = width * 10 + (*(fmt++) - '0');
+        if (*fmt == '.') {
+            fmt++;
+            prec = 0;
+            while (*fmt >= '0' && *fmt <= '9')
+                prec = prec * 10 + (*(fmt++) - '0');
+        }
+
+        ch = *(fmt++);
+        switch (ch) {
+            case 0:
+                goto end;
+
+            case 'd': {
+                int v = va_arg(va, int);
+                unsigned int u = (unsigned int)v;
+                if (v < 0) {
+                    sign = '-';
+                    u = 0u - u;
+                }
+                digits = mini_utoa(bf_end, u, 10, 0);
+                out_field(&o, sign, digits, bf_end - digits, width, left, zero);
+                break;
             }
 
-            switch (ch) {
-                case 0:
-                    goto end;
-
-                case 'u':
-                case 'd':
-                    len = mini_itoa(va_arg(va, unsigned int), 10, 0, bf, zero_pad);
-                    _puts(bf, len);
-                    break;
-
-                case 'x':
-                case 'X':
-                    len = mini_itoa(va_arg(va, unsigned int), 16, (ch=='X'), bf, zero_pad);
-                    _puts(bf, len);
-                    break;
-
-                case 'c' :
-                    _putc((char)(va_arg(va, int)));
-                    break;
-
-                case 's' :
-                    ptr = va_arg(va, char*);
-                    _puts(ptr, mini_strlen(ptr));
-                    break;
-
-                default:
-                    _putc(ch);
-                    break;
+            case 'u':
+            case 'x':
+            case 'X':
+                digits = mini_utoa(bf_end, va_arg(va, unsigned int), ch == 'u' ? 10 : 16, ch == 'X');
+                out_field(&o, 0, digits, bf_end - digits, width, left, zero);
+                break;
+
+            case 'f': {
+                double v = va_arg(va, double);
+                unsigned long long bits;
+                if (prec < 0)
+                    prec = 6;
+                if (prec > 9)
+                    prec = 9;
+                memcpy(&bits, &v, sizeof(bits));
+                if (bits >> 63)
+                    sign = '-';
+                digits = mini_ftoa(bf_end, v, prec);
+                if (digits == NULL) {
+                    /* NaN, infinity, or too large for the fixed point */
+                    digits = bits << 12 && ((bits >> 52) & 0x7ff) == 0x7ff ? "nan" : "inf";
+                    out_field(&o, sign, digits, 3, width, left, 0);
+                } else {
+                    out_field(&o, sign, digits, bf_end - digits, width, left, zero);
+                }
+                break;
             }
+
+            case 'c':
+                bf[0] = (char)va_arg(va, int);
+                out_field(&o, 0, bf, 1, width, left, 0);
+                break;
+
+            case 's': {
+                const char* s = va_arg(va, char*);
+                out_field(&o, 0, s, strlen(s), width, left, 0);
+                break;
+            }
+
+            default:
+                out_str(&o, &ch, 1);
+                break;
         }
     }
 end:
-    return pbuffer - buffer;
+    *o.p = '\0';
+    return o.p - buffer;
 }
 
 
@@ -167,4 +329,4 @@ mini_snprintf(char* buffer, unsigned int buffer_len, char* fmt, ...)
     va_end(va);
 
     return ret;
-}
\ No newline at end of file
+}
@@ -4,19 +4,28 @@
  * - http://stackoverflow.com/questions/11261170/c-and-maths-fast-approximation-of-a-trigonometric-function
  * - http://www.codeproject.com/Articles/69941/Best-Square-Root-Method-Algorithm-Function-Precisi
  */
+#include <stdint.h>
 #include "pbl-math.h"
 
+/*
+ * sqrt(n) = n * (1/sqrt(n)).  The inverse square root is seeded from the
+ * IEEE exponent/mantissa bits (rel. err. < 3.5e-2) and refined with three
+ * Newton steps, so the cost is the same for every input and there is no
+ * division.  relative error < 2.5e-7 for normal n > 0, returns 0 for n <= 0
+ */
 float pbl_sqrt(float n)
 {
-    int i;
-    n -= 1;
-    float x = 2;
-    for (; n > 1; n -= 2 * x++ - 1);
-    n += (x - 1) * (x - 1);
-    for (i = 0; i < 32; i++) {
-        x += (x * x < n) ? (float) 1 / (1 << i) : (float) -1 / (1 << i);
-    }
-    return x;
+    union { float f; int32_t i; } u;
+    float y, h;
+    if (n <= 0) return 0;
+    h = 0.5f * n;
+    u.f = n;
+    u.i = 0x5f3759df - (u.i >> 1);
+    y = u.f;
+    y = y * (1.5f - h * y * y);
+    y = y * (1.5f - h * y * y);
+    y = y * (1.5f - h * y * y);
+    return n * y;
 }
 
 float pbl_floor(float x)
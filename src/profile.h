@@ -0,0 +1,24 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <pebble.h>
+
+// Wall clock in ms for the *_PROFILE logs; only differences are meaningful
+static inline uint32_t profile_ms( void ) {
+  time_t s;
+  uint16_t ms;
+  time_ms( &s, &ms );
+  return (uint32_t)s * 1000 + ms;
+}
+
+// Clock for per-call profiles: ms on the watch, ns where the build has
+// a finer one (the host shim)
+#ifdef PROFILE_TICKS_NS
+#define profile_ticks() profile_ns()
+#define PROFILE_TICKS "ns"
+#else
+#define profile_ticks() profile_ms()
+#define PROFILE_TICKS "ms"
+#endif
+
+#endif // PROFILE_H
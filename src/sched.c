@@ -0,0 +1,233 @@
+#include <pebble.h>
+#include "sched.h"
+
+static const SchedJob *jobs;
+static int job_count;
+static uint32_t enabled;
+static time_t deadline[SCHED_MAX_JOBS];  // local epoch seconds, 0 = none
+
+static TimeUnits subscribed;
+static AppTimer *timer;
+static time_t timer_due;
+
+// Jobs are running; enables and replans wait for the end of the pass
+static bool busy, again;
+
+// The plan holds until something changes or replan_at passes
+static bool dirty;
+static time_t replan_at;
+
+// Time of the last pass, to notice the clock being set
+static time_t last_run;
+
+static SchedStats stats;
+
+static void tick_handler( struct tm *tick_time, TimeUnits units_changed );
+static void timer_fired( void *data );
+
+// Next boundary of unit after now; time() is local time on the watch
+static time_t boundary( TimeUnits unit, time_t now ) {
+  switch ( unit ) {
+    case SECOND_UNIT: return now + 1;
+    case MINUTE_UNIT: return now - now % 60 + 60;
+    case HOUR_UNIT:   return now - now % 3600 + 3600;
+    default:          return now - now % 86400 + 86400;
+  }
+}
+
+static time_t unit_seconds( TimeUnits unit ) {
+  switch ( unit ) {
+    case SECOND_UNIT: return 1;
+    case MINUTE_UNIT: return 60;
+    case HOUR_UNIT:   return 3600;
+    default:          return 86400;
+  }
+}
+
+static bool is_enabled( int i ) {
+  return ( enabled & ( 1u << i ) ) != 0;
+}
+
+/*
+  Subscribe at the finest unit an enabled job needs, refresh the next()
+  deadlines and arm the timer for one the next tick would serve too late
+*/
+static void plan( time_t now ) {
+  TimeUnits unit = DAY_UNIT;
+  time_t next_tick, due = 0;
+  int i;
+
+  for ( i = 0; i < job_count; i++ ) {
+    if ( !is_enabled( i ) ) {
+      continue;
+    }
+    if ( jobs[i].unit ) {
+      if ( jobs[i].unit < unit ) unit = jobs[i].unit;
+    } else {
+      deadline[i] = jobs[i].next( now );
+    }
+  }
+  if ( unit != subscribed ) {
+    subscribed = unit;
+    tick_timer_service_subscribe( unit, tick_handler );
+  }
+
+  // the tick before a deadline decides whether it needs the timer
+  next_tick = boundary( unit, now );
+  replan_at = 0;
+  for ( i = 0; i < job_count; i++ ) {
+    if ( !is_enabled( i ) || jobs[i].unit != 0 || deadline[i] == 0 ) {
+      continue;
+    }
+    if ( deadline[i] + jobs[i].slack < next_tick && ( due == 0 || deadline[i] < due ) ) {
+      due = deadline[i];
+    }
+    if ( replan_at == 0 || deadline[i] - unit_seconds( unit ) < replan_at ) {
+      replan_at = deadline[i] - unit_seconds( unit );
+    }
+  }
+  dirty = false;
+  if ( due != timer_due ) {
+    if ( timer ) {
+      app_timer_cancel( timer );
+      timer = NULL;
+    }
+    timer_due = due;
+    if ( due ) {
+      timer = app_timer_register( due > now ? ( due - now ) * 1000 : 0, timer_fired, NULL );
+    }
+  }
+}
+
+/*
+  The clock was set.  Deadlines are absolute times, so after a step back
+  every job would wait for the old time to come round again: run the
+  unit jobs whose unit changed now, take the others from their next
+  boundary, and ask next() again
+*/
+static void resync( time_t now ) {
+  time_t seconds;
+  int i;
+
+  for ( i = 0; i < job_count; i++ ) {
+    if ( !is_enabled( i ) ) {
+      continue;
+    }
+    if ( jobs[i].unit ) {
+      seconds = unit_seconds( jobs[i].unit );
+      deadline[i] = now / seconds != last_run / seconds ? now : boundary( jobs[i].unit, now );
+    } else {
+      deadline[i] = jobs[i].next( now );
+    }
+  }
+  dirty = true;
+}
+
+// One wakeup: every job whose deadline has passed, then the next plan
+static void run_due( struct tm *tick_time, bool from_tick ) {
+  time_t now = time( NULL );
+  int i;
+
+  // passes come at least once per subscribed unit unless the clock moved
+  if ( last_run != 0 && ( now < last_run || now - last_run > unit_seconds( subscribed ) ) ) {
+    resync( now );
+  }
+  last_run = now;
+  busy = true;
+  do {
+    again = false;
+    for ( i = 0; i < job_count; i++ ) {
+      if ( !is_enabled( i ) || deadline[i] == 0 || deadline[i] > now ) {
+        continue;
+      }
+      if ( tick_time == NULL ) {
+        tick_time = localtime( &now );
+      }
+      if ( jobs[i].unit == 0 ) {
+        stats.shared += from_tick;
+        dirty = true;
+      }
+      jobs[i].run( tick_time );
+      deadline[i] = jobs[i].unit ? boundary( jobs[i].unit, now ) : jobs[i].next( now );
+    }
+  } while ( again );
+  busy = false;
+  if ( dirty || ( replan_at != 0 && now >= replan_at ) ) {
+    plan( now );
+  }
+}
+
+static void tick_handler( struct tm *tick_time, TimeUnits units_changed ) {
+  stats.ticks++;
+  run_due( tick_time, true );
+}
+
+static void timer_fired( void *data ) {
+  timer = NULL;
+  timer_due = 0;
+  stats.timers++;
+  run_due( NULL, false );
+}
+
+void sched_start( const SchedJob *job_table, int count ) {
+  time_t now = time( NULL );
+  int i;
+
+  jobs = job_table;
+  job_count = count;
+  dirty = true;
+  last_run = 0;
+  enabled = 0;
+  subscribed = 0;
+  for ( i = 0; i < count; i++ ) {
+    if ( !( jobs[i].flags & SCHED_OFF ) ) {
+      enabled |= 1u << i;
+    }
+    if ( jobs[i].unit == 0 ) {
+      deadline[i] = jobs[i].next( now );
+    } else {
+      deadline[i] = ( jobs[i].flags & SCHED_NOW ) ? now : boundary( jobs[i].unit, now );
+    }
+  }
+  run_due( NULL, false );
+}
+
+void sched_stop( void ) {
+  tick_timer_service_unsubscribe();
+  if ( timer ) {
+    app_timer_cancel( timer );
+    timer = NULL;
+  }
+  timer_due = 0;
+  enabled = 0;
+  subscribed = 0;
+}
+
+void sched_enable( int job, bool on ) {
+  time_t now = time( NULL );
+
+  if ( on ) {
+    enabled |= 1u << job;
+    deadline[job] = jobs[job].unit ? now : jobs[job].next( now );
+  } else {
+    enabled &= ~( 1u << job );
+    deadline[job] = 0;
+  }
+  dirty = true;
+  if ( busy ) {
+    again = true;
+  } else {
+    run_due( NULL, false );
+  }
+}
+
+void sched_replan( void ) {
+  dirty = true;
+  if ( !busy ) {
+    plan( time( NULL ) );
+  }
+}
+
+const SchedStats *sched_stats( void ) {
+  return &stats;
+}
@@ -0,0 +1,53 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <pebble.h>
+
+/*
+ * Wakeup scheduler for the jobs the face runs on its own: each job has
+ * a deadline, and only the jobs whose deadline has passed run, in table
+ * order.  Jobs either run at every boundary of a unit (SECOND_UNIT ..
+ * DAY_UNIT), which the tick service is subscribed to at the finest unit
+ * an enabled job needs, or at a time their next() works out (wrist
+ * idle, weather stale).  Those ride along on a tick that comes within
+ * their slack; a single app_timer is armed only for one that would
+ * wait longer.
+ */
+typedef void (*SchedRun)( struct tm *now );
+typedef time_t (*SchedNext)( time_t now );  // 0 = nothing to do
+
+typedef struct {
+  TimeUnits unit;       // boundary the job runs at, 0: at next()
+  uint8_t flags;
+  uint16_t slack;       // seconds a next() job may run late to share a tick
+  SchedRun run;
+  SchedNext next;
+} SchedJob;
+
+enum {
+  SCHED_NOW = 1,        // run in sched_start
+  SCHED_OFF = 2         // disabled until sched_enable
+};
+
+#define SCHED_MAX_JOBS 16
+
+// Wakeups taken, and deadlines that shared a tick instead of a timer
+typedef struct {
+  uint32_t ticks;
+  uint32_t timers;
+  uint32_t shared;
+} SchedStats;
+
+// jobs must stay valid until sched_stop
+void sched_start( const SchedJob *jobs, int count );
+void sched_stop( void );
+
+// Enabling a unit job runs it now, a next() job when next() says
+void sched_enable( int job, bool on );
+
+// Work out the next() deadlines again after the state they read changed
+void sched_replan( void );
+
+const SchedStats *sched_stats( void );
+
+#endif // SCHED_H
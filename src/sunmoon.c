@@ -1,3 +1,5 @@
+#include "config.h"
+#include "sunmoon.h"
 #include "pbl-math.h"
 #define trunc(x)  ((int)(x))
 #define rad M_PI/180
@@ -111,6 +113,19 @@ static double frac1(double x)
     return frac1_result;
 }
 
+/*-----------------------------------------------------------------------*/
+/* RA_HALF: half the right ascension (rad) from x=cos(dec)cos(ra),       */
+/*          y=cos(dec)sin(ra), rho=cos(dec), i.e. atan(y/(x+rho)).       */
+/*          For x<0 the equivalent y/(rho-x) form is used, so RA near    */
+/*          12h does not divide by x+rho ~ 0.                            */
+/*-----------------------------------------------------------------------*/
+static double ra_half(double x,double y,double rho)
+{
+    if (x>=0)
+        return pbl_atan(y/(x+rho));
+    return ((y>=0) ? M_PI/2 : -M_PI/2) - pbl_atan(y/(rho-x));
+}
+
 void mini_moon(double t, double* ra,double* dec)
 {
     const double p2 = 6.283185307;
@@ -144,7 +159,7 @@ void mini_moon(double t, double* ra,double* dec)
     z=sineps*v+coseps*w;
     rho=pbl_sqrt(1.0-z*z);
     *dec = (360.0/p2)*pbl_atan(z/rho);
-    *ra  = (48.0/p2)*pbl_atan(y/(x+rho));
+    *ra  = (48.0/p2)*ra_half(x,y,rho);
     if (*ra<0)  *ra+=24.0;
 }
 
@@ -179,7 +194,7 @@ void mini_sun(double t, double* ra,double* dec)
     z=sineps*sl;
     rho=pbl_sqrt(1.0-z*z);
     *dec = (360.0/p2)*pbl_atan(z/rho);
-    *ra  = (48.0/p2)*pbl_atan(y/(x+rho));
+    *ra  = (48.0/p2)*ra_half(x,y,rho);
     if (*ra<0)  *ra+=24.0;
 }
 
@@ -199,41 +214,119 @@ double sin_alt(int iobj,double mjd0,double hour,double lambda,double cphi,double
     return sphi*sn(dec) + cphi*cs(dec)*cs(tau);
 }
 
+/*-----------------------------------------------------------------------*/
+/* EPHEM: RA, sin(DEC), cos(DEC) of one body at NANCHOR equally spaced    */
+/*        anchor times starting at hour H0.  SIN_ALT_EPHEM interpolates   */
+/*        them (constant, linear, or quadratic through the three nearest  */
+/*        anchors) instead of re-running MINI_SUN/MINI_MOON, so each      */
+/*        altitude costs one cosine instead of a full ephemeris + 3 trig. */
+/*-----------------------------------------------------------------------*/
+#define MAX_ANCHOR 5
+
+typedef struct {
+    int nanchor;
+    double h0;                  /* hour of the first anchor */
+    double step;                /* hours between anchors */
+    double ra[MAX_ANCHOR];      /* unwrapped, may leave [0h,24h) */
+    double sdec[MAX_ANCHOR];
+    double cdec[MAX_ANCHOR];
+} Ephem;
+
+static void ephem_init(Ephem* e, int iobj, double mjd0, double h0, double step, int nanchor)
+{
+    int i;
+    double t,dec;
+    e->nanchor = nanchor;
+    e->h0 = h0;
+    e->step = step;
+    for (i=0; i<nanchor; i++) {
+        t = (mjd0 + (h0+i*step)/24.0 - 51544.5)/36525.0;
+        if (iobj==0)
+            mini_moon(t,&e->ra[i],&dec);
+        else  mini_sun(t,&e->ra[i],&dec);
+        if (i>0 && e->ra[i]-e->ra[i-1] < -12.0)  e->ra[i] += 24.0;
+        if (i>0 && e->ra[i]-e->ra[i-1] > 12.0)  e->ra[i] -= 24.0;
+        e->sdec[i] = sn(dec);
+        e->cdec[i] = cs(dec);
+    }
+}
+
+static double ephem_at(const Ephem* e, const double* f, double hour)
+{
+    int k;
+    double p;
+    p = (hour-e->h0)/e->step;
+    if (e->nanchor==1)  return f[0];
+    if (e->nanchor==2)  return f[0] + p*(f[1]-f[0]);
+    k = trunc(p + 0.5);
+    if (k<1)  k=1;
+    if (k>e->nanchor-2)  k=e->nanchor-2;
+    p -= k;
+    return f[k] + 0.5*p*(f[k+1]-f[k-1]) + 0.5*p*p*(f[k+1]-2.0*f[k]+f[k-1]);
+}
+
+static double sin_alt_ephem(const Ephem* e,double mjd0,double hour,double lambda,double cphi,double sphi)
+{
+    double tau;
+    tau = 15.0 * (lmst(mjd0 + hour/24.0,lambda) - ephem_at(e,e->ra,hour));
+    return sphi*ephem_at(e,e->sdec,hour) + cphi*ephem_at(e,e->cdec,hour)*cs(tau);
+}
+
+/* sin of the altitude at which the event is counted */
+static double horizon(int iobj)
+{
+    static const double h0[] = {
+        +8.0/60.0,  /* moonrise          at h= +8'        */
+        -50.0/60.0, /* sunrise           at h=-50'        */
+        -6.0        /* civil twilight    at h=-6 degrees  */
+    };
+    return sn(h0[iobj]);
+}
+
+static double altitude(int iobj,const Ephem* e,double mjd0,double hour,double lambda,double cphi,double sphi)
+{
+    if (e)
+        return sin_alt_ephem(e,mjd0,hour,lambda,cphi,sphi);
+    return sin_alt(iobj,mjd0,hour,lambda,cphi,sphi);
+}
+
 /*
- * Calculate rise and set time for sun and moon
- * 0 = moon rise / set
- * 1 = sun rise / set
- * 2 = sun dawn / dusk
+ * Rise/set search over [0h,24h] in 2h intervals.  interp selects how the
+ * altitude is evaluated: 0 = full ephemeris at every point, 1 = EPHEM.
  */
-void sunmooncalc(double jd, float tz, float lat, float lon, int iobj, float* utrise, float* utset)
+static void rise_set_search(double jd, float tz, float lat, float lon, int iobj,
+                            int interp, float* utrise, float* utset)
 {
     unsigned char rise,sett;
     int nz;
     double lambda,zone,phi,sphi,cphi;
     double date,hour;
     double y_minus,y_0,y_plus,zero1,zero2,xe,ye;
-    double sinh0[] = {
-        sn(+8.0/60.0),  /* moonrise          at h= +8'        */
-        sn(-50.0/60.0),  /* sunrise           at h=-50'        */
-        sn(-6.0)
-    };  /* civil twilight at h=-6 degrees */
+    Ephem ephem;
+    const Ephem* e;
+    double sinh0 = horizon(iobj);
     zone = tz / 24.0;
     lambda = lon;
     phi = lat;
     sphi = sn(phi);
     cphi = cs(phi);
     date = (long)(jd-2400000.5)-zone;
+    /* the moon moves ~13 deg/day, the sun ~1 deg/day */
+    if (iobj==0)
+        ephem_init(&ephem,iobj,date,0.0,6.0,5);
+    else  ephem_init(&ephem,iobj,date,0.0,12.0,3);
+    e = interp ? &ephem : 0;
     hour = 1.0;
-    y_minus = sin_alt(iobj,date,hour-1.0,lambda,cphi,sphi)
-              - sinh0[iobj];
+    y_minus = altitude(iobj,e,date,hour-1.0,lambda,cphi,sphi)
+              - sinh0;
     rise = false;
     sett = false;
     /* loop over search intervals from [0h-2h] to [22h-24h]  */
     do {
-        y_0    = sin_alt(iobj,date,hour,lambda,cphi,sphi)
-                 -  sinh0[iobj];
-        y_plus = sin_alt(iobj,date,hour+1.0,lambda,cphi,sphi)
-                 -  sinh0[iobj];
+        y_0    = altitude(iobj,e,date,hour,lambda,cphi,sphi)
+                 -  sinh0;
+        y_plus = altitude(iobj,e,date,hour+1.0,lambda,cphi,sphi)
+                 -  sinh0;
         /* find parabola through three values Y_MINUS,Y_0,Y_PLUS */
         quad(y_minus,y_0,y_plus, &xe,&ye, &zero1,&zero2, &nz);
         switch (nz) {
@@ -268,3 +361,140 @@ void sunmooncalc(double jd, float tz, float lat, float lon, int iobj, float* utr
     if (rise!=true) *utrise=99.0;
     if (sett!=true) *utset=99.0;
 }
+
+/*
+ * Calculate rise and set time for sun and moon
+ * 0 = moon rise / set
+ * 1 = sun rise / set
+ * 2 = sun dawn / dusk
+ */
+void sunmooncalc(double jd, float tz, float lat, float lon, int iobj, float* utrise, float* utset)
+{
+    rise_set_search(jd, tz, lat, lon, iobj, 0, utrise, utset);
+}
+
+/*
+ * Same as sunmooncalc, but RA/Dec are computed at a few anchor times
+ * and interpolated in between (see EPHEM).  Times differ from
+ * sunmooncalc by well under a minute; host/interp_check measures it.
+ */
+void sunmooncalc_interp(double jd, float tz, float lat, float lon, int iobj, float* utrise, float* utset)
+{
+    rise_set_search(jd, tz, lat, lon, iobj, 1, utrise, utset);
+}
+
+/*-----------------------------------------------------------------------*/
+/* REFINE: root of sin_alt-sinh0 inside [lo,hi] by regula falsi          */
+/*         (Illinois variant), altitudes from an EPHEM spanning the      */
+/*         window.  DIR>0 looks for a rising crossing, DIR<0 for a       */
+/*         setting one.  Returns false when [lo,hi] leaves the day or    */
+/*         does not bracket such a crossing.                             */
+/*-----------------------------------------------------------------------*/
+static int refine(int iobj,double mjd0,double lo,double hi,int dir,
+                  double lambda,double cphi,double sphi,double sinh0,double* root)
+{
+    double flo,fhi,x,xold,fx;
+    int i,side;
+    Ephem e;
+    if (lo<0.0 || hi>24.0)  return false;
+    /* RA/Dec over a window this short: the sun's are constant to a
+       fraction of a second of time, the moon's linear */
+    if (iobj==0)
+        ephem_init(&e,iobj,mjd0,lo,hi-lo,2);
+    else  ephem_init(&e,iobj,mjd0,0.5*(lo+hi),1.0,1);
+    flo = dir*(sin_alt_ephem(&e,mjd0,lo,lambda,cphi,sphi) - sinh0);
+    fhi = dir*(sin_alt_ephem(&e,mjd0,hi,lambda,cphi,sphi) - sinh0);
+    if (flo>=0.0 || fhi<=0.0)  return false;
+    x = lo;
+    side = 0;
+    for (i=0; i<8; i++) {
+        xold = x;
+        x = (lo*fhi - hi*flo)/(fhi-flo);
+        fx = dir*(sin_alt_ephem(&e,mjd0,x,lambda,cphi,sphi) - sinh0);
+        if (fx<0.0) {
+            lo = x;  flo = fx;
+            if (side==-1)  fhi *= 0.5;
+            side = -1;
+        } else {
+            hi = x;  fhi = fx;
+            if (side==1)  flo *= 0.5;
+            side = 1;
+        }
+        if (dabs(x-xold) < 1.0/3600.0)  break;  /* 1 second */
+    }
+    *root = x;
+    return true;
+}
+
+/*
+ * Rise and set for the day after the one that gave prevrise/prevset
+ * (as returned by sunmooncalc*, 99.0 = none).  Each event is searched
+ * in a short window around where yesterday's predicts it and refined
+ * with a few regula falsi steps; anything that does not bracket there
+ * (no event yesterday, polar day/night, moon skipping a day, window
+ * crossing midnight) falls back to the full sweep of sunmooncalc_interp.
+ */
+void sunmooncalc_warm(double jd, float tz, float lat, float lon, int iobj,
+                      float prevrise, float prevset, float* utrise, float* utset)
+{
+    /* day-to-day drift of the event and half width of the window, hours */
+    const double drift = (iobj==0) ? 0.84 : 0.0;
+    const double width = (iobj==0) ? 0.75 : 0.25;
+    double date,sphi,cphi,sinh0,r,s;
+    int gotrise,gotset;
+    float fr,fs;
+    date = (long)(jd-2400000.5)-tz/24.0;
+    sphi = sn(lat);
+    cphi = cs(lat);
+    sinh0 = horizon(iobj);
+    gotrise = (prevrise!=99.0) &&
+        refine(iobj,date,prevrise+drift-width,prevrise+drift+width,1,lon,cphi,sphi,sinh0,&r);
+    gotset = (prevset!=99.0) &&
+        refine(iobj,date,prevset+drift-width,prevset+drift+width,-1,lon,cphi,sphi,sinh0,&s);
+    if (!gotrise || !gotset)
+        sunmooncalc_interp(jd, tz, lat, lon, iobj, &fr, &fs);
+    *utrise = gotrise ? r : fr;
+    *utset  = gotset  ? s : fs;
+}
+
+/*
+ * Bring rs up to date for day jd at (tz, lat, lon).  Nothing is computed
+ * when it already holds that day and place; the day after the cached
+ * one is warm-started from it.  Returns true if the times were
+ * recomputed.
+ */
+int riseset_update(RiseSet* rs, int jd, float tz, float lat, float lon, int iobj)
+{
+    int same_place = rs->jd != 0 && rs->tz == tz && rs->lat == lat && rs->lon == lon;
+    if (same_place && rs->jd == jd)
+        return false;
+#ifdef SUNMOON_FIXED
+    sunmooncalc_fixed(jd, tz, lat, lon, iobj, &rs->rise, &rs->set);
+#else
+    if (same_place && rs->jd == jd-1)
+        sunmooncalc_warm(jd, tz, lat, lon, iobj, rs->rise, rs->set, &rs->rise, &rs->set);
+    else
+        sunmooncalc_interp(jd, tz, lat, lon, iobj, &rs->rise, &rs->set);
+#endif
+    rs->jd = jd;
+    rs->tz = tz;
+    rs->lat = lat;
+    rs->lon = lon;
+    return true;
+}
+
+/* Julian day number of a Gregorian calendar date (month 1-12) */
+int jdn(int y, int m, int d)
+{
+    return d-32075+1461*(y+4800+(m-14)/12)/4+367*(m-2-(m-14)/12*12)/12-3*((y+4900+(m-14)/12)/100)/4;
+}
+
+/* age of the moon in the synodic month, 0 = new moon, 0.5 = full */
+float moon_phase(int jdn)
+{
+    double jd;
+    jd = jdn-2451550.1;
+    jd /= 29.530588853;
+    jd -= (int)jd;
+    return jd;
+}
@@ -1 +1,24 @@
+#ifndef SUNMOON_H
+#define SUNMOON_H
+
 void sunmooncalc(double jd, float tz, float lat, float lon, int iobj, float* utrise, float* utset);
+void sunmooncalc_interp(double jd, float tz, float lat, float lon, int iobj, float* utrise, float* utset);
+void sunmooncalc_warm(double jd, float tz, float lat, float lon, int iobj,
+                      float prevrise, float prevset, float* utrise, float* utset);
+
+// integer/fixed-point version of sunmooncalc (sunmoon_fixed.c)
+void sunmooncalc_fixed(double jd, float tz, float lat, float lon, int iobj, float* utrise, float* utset);
+
+int jdn(int y, int m, int d);
+float moon_phase(int jdn);
+
+// Rise/set of one object for one day and place, kept between calls
+typedef struct {
+    int jd;             // day the times are for, 0 = nothing cached
+    float tz, lat, lon;
+    float rise, set;    // 99.0 = no event that day
+} RiseSet;
+
+int riseset_update(RiseSet* rs, int jd, float tz, float lat, float lon, int iobj);
+
+#endif // SUNMOON_H
@@ -0,0 +1,318 @@
+/*
+ * Integer-only version of the rise/set pipeline in sunmoon.c, for CPUs
+ * without an FPU where every double operation is a library call.
+ *
+ *   angles   binary angle units (BAM): 2^32 = one turn, so the FRAC()
+ *            of a revolution count is just unsigned wrap-around
+ *   values   sines, cosines and sin(altitude) in Q30
+ *   time     days since J2000 and hours of the search in Q16
+ *
+ * Same model as sunmooncalc (MINI_SUN/MINI_MOON series, LMST, 2h
+ * parabola search), with two shortcuts that need no trig at all:
+ * sin/cos(dec) are the z and the x-y norm of the unit vector, and RA
+ * and that norm both come out of one CORDIC pass.  Floats only appear
+ * in the interface (converted once per call).
+ */
+#include <stdint.h>
+#include "sunmoon.h"
+
+typedef int64_t q64;
+
+#define Q30(x)      ((int32_t)((x) * 1073741824.0))
+#define BAM(rev)    ((uint32_t)(int64_t)((rev) * 4294967296.0))
+/* revolutions per Julian century -> revolutions per day in Q48 */
+#define RATE(c)     ((uint64_t)(int64_t)((c) / 36525.0 * 281474976710656.0))
+/* arcseconds -> BAM: 2^32 / 1296000 */
+#define ARCSEC_BAM  3314
+
+/* sin(i * pi/256), i = 0..128, Q30 */
+static const int32_t SIN_QUARTER[129] = {
+    0, 13176464, 26350943, 39521455, 52686014, 65842639,
+    78989349, 92124163, 105245103, 118350194, 131437462, 144504935,
+    157550647, 170572633, 183568930, 196537583, 209476638, 222384147,
+    235258165, 248096755, 260897982, 273659918, 286380643, 299058239,
+    311690799, 324276419, 336813204, 349299266, 361732726, 374111709,
+    386434353, 398698801, 410903207, 423045732, 435124548, 447137835,
+    459083786, 470960600, 482766489, 494499676, 506158392, 517740883,
+    529245404, 540670223, 552013618, 563273883, 574449320, 585538248,
+    596538995, 607449906, 618269338, 628995660, 639627258, 650162530,
+    660599890, 670937767, 681174602, 691308855, 701339000, 711263525,
+    721080937, 730789757, 740388522, 749875788, 759250125, 768510122,
+    777654384, 786681534, 795590213, 804379079, 813046808, 821592095,
+    830013654, 838310216, 846480531, 854523370, 862437520, 870221790,
+    877875009, 885396022, 892783698, 900036924, 907154608, 914135678,
+    920979082, 927683790, 934248793, 940673101, 946955747, 953095785,
+    959092290, 964944360, 970651112, 976211688, 981625251, 986890984,
+    992008094, 996975812, 1001793390, 1006460100, 1010975242, 1015338134,
+    1019548121, 1023604567, 1027506862, 1031254418, 1034846671, 1038283080,
+    1041563127, 1044686319, 1047652185, 1050460278, 1053110176, 1055601479,
+    1057933813, 1060106826, 1062120190, 1063973603, 1065666786, 1067199483,
+    1068571464, 1069782521, 1070832474, 1071721163, 1072448455, 1073014240,
+    1073418433, 1073660973, 1073741824
+};
+
+/* atan(2^-i) in BAM */
+static const uint32_t CORDIC_ATAN[24] = {
+    536870912, 316933406, 167458907, 85004756, 42667331, 21354465,
+    10679838, 5340245, 2670163, 1335087, 667544, 333772,
+    166886, 83443, 41722, 20861, 10430, 5215,
+    2608, 1304, 652, 326, 163, 81
+};
+#define CORDIC_INV_GAIN 652032874   /* 1/prod(sqrt(1+2^-2i)), Q30 */
+
+/* sin of a binary angle, Q30; linear interpolation, abs. error < 2e-5 */
+static int32_t sin_bam(uint32_t a)
+{
+    uint32_t x = a & 0x3fffffff;
+    int32_t v;
+    int i, f;
+    if (a & 0x40000000)  x = 0x40000000 - x;
+    if (x == 0x40000000) {
+        v = SIN_QUARTER[128];
+    } else {
+        i = x >> 23;
+        f = (x >> 7) & 0xffff;
+        v = SIN_QUARTER[i] + (int32_t)(((q64)(SIN_QUARTER[i+1] - SIN_QUARTER[i]) * f) >> 16);
+    }
+    return (a & 0x80000000) ? -v : v;
+}
+
+static int32_t cos_bam(uint32_t a)
+{
+    return sin_bam(a + 0x40000000);
+}
+
+static int32_t mulq30(int32_t a, int32_t b)
+{
+    return (int32_t)(((q64)a * b) >> 30);
+}
+
+/*
+ * CORDIC vectoring: atan2(y, x) as a binary angle, and sqrt(x^2+y^2)
+ * in *r.  x, y in Q30 with |(x,y)| <= 1.
+ */
+static uint32_t atan2_bam(int32_t y, int32_t x, int32_t* r)
+{
+    uint32_t angle = 0;
+    int32_t xn;
+    int i;
+    x >>= 2;            /* headroom for the CORDIC gain of 1.647 */
+    y >>= 2;
+    if (x < 0) {
+        x = -x;
+        y = -y;
+        angle = 0x80000000;
+    }
+    for (i = 0; i < 24; i++) {
+        if (y > 0) {
+            xn = x + (y >> i);
+            y -= x >> i;
+            angle += CORDIC_ATAN[i];
+        } else {
+            xn = x - (y >> i);
+            y += x >> i;
+            angle -= CORDIC_ATAN[i];
+        }
+        x = xn;
+    }
+    *r = mulq30(x, CORDIC_INV_GAIN) * 4;
+    return angle;
+}
+
+/* integer square root of a non-negative 64 bit value */
+static uint32_t isqrt64(uint64_t n)
+{
+    uint64_t root = 0, bit = (uint64_t)1 << 62;
+    while (bit > n)  bit >>= 2;
+    while (bit) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+/* c0 + rate * d as a binary angle; d = days since J2000 in Q16 */
+static uint32_t mean_angle(uint32_t c0, uint64_t rate, q64 d)
+{
+    return c0 + (uint32_t)((rate * (uint64_t)d) >> 32);
+}
+
+/* equatorial unit vector -> RA, sin(dec), cos(dec) */
+typedef struct {
+    uint32_t ra;
+    int32_t sdec, cdec;
+} Radec;
+
+#define COSEPS Q30(0.91748)
+#define SINEPS Q30(0.39778)
+
+static void ecliptic_to_radec(int32_t x, int32_t v, int32_t w, Radec* p)
+{
+    int32_t y, z;
+    y = mulq30(COSEPS, v) - mulq30(SINEPS, w);
+    z = mulq30(SINEPS, v) + mulq30(COSEPS, w);
+    p->ra = atan2_bam(y, x, &p->cdec);
+    p->sdec = z;
+}
+
+/* MINI_SUN, d = days since J2000 in Q16 */
+static void fixed_sun(q64 d, Radec* p)
+{
+    uint32_t m, l;
+    q64 dl;
+    int32_t sl;
+    m  = mean_angle(BAM(0.993133), RATE(99.997361), d);
+    dl = (q64)6893*sin_bam(m) + (q64)72*sin_bam(2*m);      /* arcsec, Q30 */
+    l  = mean_angle(BAM(0.7859453), RATE(6191.2/1296E3), d) + m
+         + (uint32_t)((dl * ARCSEC_BAM) >> 30);
+    sl = sin_bam(l);
+    ecliptic_to_radec(cos_bam(l), sl, 0, p);
+}
+
+/* MINI_MOON, d = days since J2000 in Q16 */
+static void fixed_moon(q64 d, Radec* p)
+{
+    uint32_t l0,l,ls,dd,f,h,s,lm,bm;
+    q64 dl,n;
+    int32_t cb;
+    l0 = mean_angle(BAM(0.606433), RATE(1336.855225), d);
+    l  = mean_angle(BAM(0.374897), RATE(1325.552410), d);
+    ls = mean_angle(BAM(0.993133), RATE(  99.997361), d);
+    dd = mean_angle(BAM(0.827361), RATE(1236.853086), d);
+    f  = mean_angle(BAM(0.259086), RATE(1342.227825), d);
+    /* arcsec, Q30 */
+    dl = (q64)22640*sin_bam(l) - (q64)4586*sin_bam(l-2*dd) + (q64)2370*sin_bam(2*dd)
+         + (q64)769*sin_bam(2*l) - (q64)668*sin_bam(ls) - (q64)412*sin_bam(2*f)
+         - (q64)212*sin_bam(2*l-2*dd) - (q64)206*sin_bam(l+ls-2*dd) + (q64)192*sin_bam(l+2*dd)
+         - (q64)165*sin_bam(ls-2*dd) - (q64)125*sin_bam(dd) - (q64)110*sin_bam(l+ls)
+         + (q64)148*sin_bam(l-ls) - (q64)55*sin_bam(2*f-2*dd);
+    s = f + (uint32_t)(((dl + (q64)412*sin_bam(2*f) + (q64)541*sin_bam(ls)) * ARCSEC_BAM) >> 30);
+    h = f-2*dd;
+    n = -(q64)526*sin_bam(h) + (q64)44*sin_bam(l+h) - (q64)31*sin_bam(h-l) - (q64)23*sin_bam(ls+h)
+        + (q64)11*sin_bam(h-ls) - (q64)25*sin_bam(f-2*l) + (q64)21*sin_bam(f-l);
+    lm = l0 + (uint32_t)((dl * ARCSEC_BAM) >> 30);
+    bm = (uint32_t)((((q64)18520*sin_bam(s) + n) * ARCSEC_BAM) >> 30);
+    cb = cos_bam(bm);
+    ecliptic_to_radec(mulq30(cb, cos_bam(lm)), mulq30(cb, sin_bam(lm)), sin_bam(bm), p);
+}
+
+/* LMST as a binary angle; lambda = west longitude as a binary angle */
+static uint32_t fixed_lmst(q64 d, uint32_t lambda)
+{
+    return mean_angle(BAM(0.779057273264), RATE(1.0027379093*36525.0), d) - lambda;
+}
+
+/* SIN_ALT in Q30; date = days since J2000 of 0h in Q16, hour in Q16 */
+static int32_t fixed_sin_alt(int iobj, q64 date, int32_t hour, uint32_t lambda,
+                             int32_t cphi, int32_t sphi)
+{
+    Radec p;
+    q64 d = date + hour/24;
+    if (iobj==0)
+        fixed_moon(d,&p);
+    else  fixed_sun(d,&p);
+    return mulq30(sphi, p.sdec) + mulq30(mulq30(cphi, p.cdec), cos_bam(fixed_lmst(d,lambda) - p.ra));
+}
+
+/*
+ * QUAD in fixed point: y values Q30, results Q16 in units of the
+ * half interval (+-1.0 = 65536).
+ */
+static void fixed_quad(int32_t y_minus, int32_t y_0, int32_t y_plus,
+                       int32_t* ye_sign, int32_t* zero1, int32_t* zero2, int* nz)
+{
+    q64 a,b,c,xe,xc,ye,dis,dx,z1,z2;
+    *nz = 0;
+    /* Q28 keeps b*b and 4*a*c inside 64 bits */
+    a = (((q64)y_minus + y_plus) >> 3) - (y_0 >> 2);
+    b = ((q64)y_plus - y_minus) >> 3;
+    c = y_0 >> 2;
+    if (a == 0)  a = 1;
+    xe = -(b * 65536) / (2*a);                  /* Q16 */
+    /* only the sign of ye matters, and only when xe is near [-1,1] */
+    xc = xe;
+    if (xc > (64 << 16))  xc = 64 << 16;
+    if (xc < -(64 << 16))  xc = -(64 << 16);
+    ye = ((((a*xc) >> 16) + b) * xc >> 16) + c; /* Q28 */
+    *ye_sign = (ye < 0) ? -1 : 1;
+    dis = b*b - 4*a*c;                          /* Q56 */
+    if (dis >= 0) {
+        dx = ((q64)isqrt64(dis) << 16) / (2*(a < 0 ? -a : a));
+        z1 = xe - dx;
+        z2 = xe + dx;
+        if (z1 >= -65536 && z1 <= 65536)  *nz += 1;
+        if (z2 >= -65536 && z2 <= 65536)  *nz += 1;
+        if (z1 < -65536)  z1 = z2;
+        /* only read back for roots inside [-1,1] */
+        *zero1 = (int32_t)z1;
+        *zero2 = (int32_t)z2;
+    }
+}
+
+/*
+ * Drop-in replacement for sunmooncalc; see there for the arguments.
+ */
+void sunmooncalc_fixed(double jd, float tz, float lat, float lon, int iobj, float* utrise, float* utset)
+{
+    static const int32_t sinh0[] = {
+        Q30(0.002327105),   /* sin(+8')   moonrise           */
+        Q30(-0.014543897),  /* sin(-50')  sunrise            */
+        Q30(-0.104528463)   /* sin(-6 deg) civil twilight    */
+    };
+    unsigned char rise = 0, sett = 0;
+    int nz;
+    int32_t hour, y_minus, y_0, y_plus, zero1, zero2, ye_sign;
+    int32_t sphi, cphi;
+    uint32_t lambda, phi;
+    q64 date;
+
+    /* through 64 bits: +-180 deg is 2^31, one past int32_t */
+    phi = (uint32_t)(q64)(lat * (4294967296.0f / 360.0f));
+    lambda = (uint32_t)(q64)(lon * (4294967296.0f / 360.0f));
+    sphi = sin_bam(phi);
+    cphi = cos_bam(phi);
+    /* local midnight in UT, as days since J2000 (MJD 51544.5) */
+    date = (q64)((long)(jd - 2400000.5) - 51544) * 65536 - 32768
+           - (q64)(int32_t)(tz * (65536.0f / 24.0f));
+
+    hour = 1 << 16;
+    y_minus = fixed_sin_alt(iobj, date, hour - (1 << 16), lambda, cphi, sphi) - sinh0[iobj];
+    do {
+        y_0    = fixed_sin_alt(iobj, date, hour, lambda, cphi, sphi) - sinh0[iobj];
+        y_plus = fixed_sin_alt(iobj, date, hour + (1 << 16), lambda, cphi, sphi) - sinh0[iobj];
+        fixed_quad(y_minus, y_0, y_plus, &ye_sign, &zero1, &zero2, &nz);
+        switch (nz) {
+        case 0:
+            break;
+        case 1:
+            if (y_minus < 0) {
+                *utrise = (hour + zero1) / 65536.0f;
+                rise = 1;
+            } else {
+                *utset = (hour + zero1) / 65536.0f;
+                sett = 1;
+            }
+            break;
+        case 2:
+            if (ye_sign < 0) {
+                *utrise = (hour + zero2) / 65536.0f;
+                *utset = (hour + zero1) / 65536.0f;
+            } else {
+                *utrise = (hour + zero1) / 65536.0f;
+                *utset = (hour + zero2) / 65536.0f;
+            }
+            rise = 1;
+            sett = 1;
+            break;
+        }
+        y_minus = y_plus;
+        hour += 2 << 16;
+    } while (!((hour >= (25 << 16)) || (rise && sett)));
+    if (!rise) *utrise = 99.0;
+    if (!sett) *utset = 99.0;
+}
@@ -0,0 +1,95 @@
+#include <string.h>
+#include "timefmt.h"
+
+static const char TWO_DIGITS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char* const DAY_NAMES[7] = {
+    "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"
+};
+
+static const char MONTH_NAMES[12][4] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+static int use_24h;
+
+void timefmt_set_24h(int is_24h)
+{
+    use_24h = is_24h;
+}
+
+int timefmt_is_24h(void)
+{
+    return use_24h;
+}
+
+// two digits of 0-99 at p
+static char* put2(char* p, int v)
+{
+    p[0] = TWO_DIGITS[2 * v];
+    p[1] = TWO_DIGITS[2 * v + 1];
+    return p + 2;
+}
+
+void timefmt_time(char* buf, const struct tm* t)
+{
+    int h = t->tm_hour;
+    char* p = buf;
+    if (!use_24h) {
+        h = h % 12;
+        if (h == 0) h = 12;
+    }
+    if (!use_24h && h < 10) {
+        *p++ = '0' + h;
+    } else {
+        p = put2(p, h);
+    }
+    *p++ = ':';
+    p = put2(p, t->tm_min);
+    *p = '\0';
+}
+
+void timefmt_ampm(char* buf, const struct tm* t)
+{
+    if (use_24h) {
+        buf[0] = '\0';
+        return;
+    }
+    buf[0] = t->tm_hour < 12 ? 'A' : 'P';
+    buf[1] = 'M';
+    buf[2] = '\0';
+}
+
+void timefmt_seconds(char* buf, const struct tm* t)
+{
+    put2(buf, t->tm_sec)[0] = '\0';
+}
+
+void timefmt_day(char* buf, const struct tm* t)
+{
+    strcpy(buf, DAY_NAMES[t->tm_wday]);
+}
+
+void timefmt_date(char* buf, const struct tm* t)
+{
+    memcpy(buf, MONTH_NAMES[t->tm_mon], 3);
+    buf[3] = ' ';
+    // %e: day of month padded with a space
+    if (t->tm_mday < 10) {
+        buf[4] = ' ';
+        buf[5] = '0' + t->tm_mday;
+    } else {
+        put2(buf + 4, t->tm_mday);
+    }
+    buf[6] = '\0';
+}
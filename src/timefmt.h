@@ -0,0 +1,30 @@
+#ifndef TIMEFMT_H
+#define TIMEFMT_H
+
+#include <time.h>
+
+/*
+ * strftime replacements for the fields handle_tick updates, writing
+ * straight into the caller's buffer with no locale or format parsing.
+ * The output matches strftime in the C locale:
+ *
+ *   timefmt_time     "%H:%M" (24h) or "%I:%M" without its leading zero
+ *   timefmt_ampm     "%p" (12h) or "" (24h)
+ *   timefmt_seconds  "%S"
+ *   timefmt_day      "%A"
+ *   timefmt_date     "%b %e"
+ *
+ * Buffers must hold the longest result: 6, 3, 3, 10 and 7 bytes.
+ */
+
+// Cache the 12/24h setting (clock_is_24h_style() on the watch)
+void timefmt_set_24h(int is_24h);
+int timefmt_is_24h(void);
+
+void timefmt_time(char* buf, const struct tm* t);
+void timefmt_ampm(char* buf, const struct tm* t);
+void timefmt_seconds(char* buf, const struct tm* t);
+void timefmt_day(char* buf, const struct tm* t);
+void timefmt_date(char* buf, const struct tm* t);
+
+#endif // TIMEFMT_H
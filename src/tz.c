@@ -0,0 +1,100 @@
+#include "tz.h"
+#include "sunmoon.h"
+
+#define SUNDAY 0
+#define LAST   -1
+
+// The rules as they stand: US since 2007, EU since 1996, AU since 2008, NZ since 2007
+#define NO_DST  { 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0 }
+#define US_DST  { 3, 2, SUNDAY, 0, 120 }, { 11, 1, SUNDAY, 0, 120 }
+#define EU_DST  { 3, LAST, SUNDAY, 1, 60 }, { 10, LAST, SUNDAY, 1, 60 }
+#define AU_DST  { 10, 1, SUNDAY, 0, 120 }, { 4, 1, SUNDAY, 0, 180 }
+#define NZ_DST  { 9, LAST, SUNDAY, 0, 120 }, { 4, 1, SUNDAY, 0, 180 }
+
+const TzZone tz_zones[TZ_ZONES] = {
+    [TZ_UTC]            = {    0,  0, NO_DST },
+    [TZ_US_HAWAII]      = { -600,  0, NO_DST },
+    [TZ_US_ALASKA]      = { -540, 60, US_DST },
+    [TZ_US_PACIFIC]     = { -480, 60, US_DST },
+    [TZ_US_ARIZONA]     = { -420,  0, NO_DST },
+    [TZ_US_MOUNTAIN]    = { -420, 60, US_DST },
+    [TZ_US_CENTRAL]     = { -360, 60, US_DST },
+    [TZ_US_EASTERN]     = { -300, 60, US_DST },
+    [TZ_US_ATLANTIC]    = { -240, 60, US_DST },
+    [TZ_UK]             = {    0, 60, EU_DST },
+    [TZ_CENTRAL_EUROPE] = {   60, 60, EU_DST },
+    [TZ_EASTERN_EUROPE] = {  120, 60, EU_DST },
+    [TZ_INDIA]          = {  330,  0, NO_DST },
+    [TZ_CHINA]          = {  480,  0, NO_DST },
+    [TZ_JAPAN]          = {  540,  0, NO_DST },
+    [TZ_SYDNEY]         = {  600, 60, AU_DST },
+    [TZ_AUCKLAND]       = {  720, 60, NZ_DST },
+};
+
+// 0 = Sunday
+static int weekday(int jd)
+{
+    return (jd + 1) % 7;
+}
+
+// Day of the change in year y
+static int change_jd(int y, const TzChange* c)
+{
+    int jd;
+    if (c->week == LAST) {
+        jd = (c->month == 12 ? jdn(y + 1, 1, 1) : jdn(y, c->month + 1, 1)) - 1;
+        return jd - (weekday(jd) - c->wday + 7) % 7;
+    }
+    jd = jdn(y, c->month, 1);
+    return jd + (c->wday - weekday(jd) + 7) % 7 + 7 * (c->week - 1);
+}
+
+// Standard time minutes from the first day of the year; clock_save is
+// what the wall clock is ahead of standard time just before the change
+static int32_t change_minute(const TzYear* y, int year, const TzChange* c, int clock_save)
+{
+    int minute = c->utc ? c->minute + y->zone->offset : c->minute - clock_save;
+    return (int32_t)(change_jd(year, c) - y->first_jd) * 1440 + minute;
+}
+
+static void work_out_year(TzYear* y, int jd)
+{
+    // 146097 days in 400 years; the guess is off by a year at most
+    int year = 2000 + (int)((jd - jdn(2000, 1, 1)) * 400LL / 146097);
+    while (jdn(year, 1, 1) > jd) year--;
+    while (jdn(year + 1, 1, 1) <= jd) year++;
+    y->first_jd = jdn(year, 1, 1);
+    y->next_jd = jdn(year + 1, 1, 1);
+    y->start = change_minute(y, year, &y->zone->start, 0);
+    y->end = change_minute(y, year, &y->zone->end, y->zone->save);
+}
+
+void tz_init(TzYear* y, const TzZone* zone)
+{
+    y->zone = zone;
+    y->first_jd = y->next_jd = 0;
+}
+
+int tz_save(TzYear* y, int jd, int minute)
+{
+    int32_t t;
+    if (y->zone->start.month == 0) return 0;
+    if (jd < y->first_jd || jd >= y->next_jd) work_out_year(y, jd);
+    t = (int32_t)(jd - y->first_jd) * 1440 + minute;
+    // southern zones save over the new year
+    if (y->start < y->end ? (t >= y->start && t < y->end) : (t >= y->start || t < y->end)) {
+        return y->zone->save;
+    }
+    return 0;
+}
+
+float tz_local(TzYear* y, int jd, float hours)
+{
+    int save;
+    if (hours == 99.0) return hours;
+    save = tz_save(y, jd, (int)(hours * 60));
+    if (save == 0) return hours;
+    // an event in the last hour of the standard day comes out at 24 or
+    // later: after midnight, on the next day's clock
+    return hours + save / 60.0;
+}
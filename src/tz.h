@@ -0,0 +1,67 @@
+#ifndef TZ_H
+#define TZ_H
+
+#include <stdint.h>
+
+/*
+ * Time zones as a standard UTC offset and, for zones that have one,
+ * the daylight saving rule in force now (rules of past years are not
+ * kept).  Rise and set are worked out in standard time; tz_local()
+ * moves them onto the wall clock.  The two changes of a year are worked
+ * out the first time a day of that year is asked for, so a conversion
+ * is a compare or two.
+ */
+typedef struct {
+    uint8_t month;              // 1-12, 0 = standard time all year
+    int8_t week;                // 1-4: that weekday of the month, -1: the last
+    uint8_t wday;               // 0 = Sunday
+    uint8_t utc;                // minute is UTC, not wall clock time
+    int16_t minute;             // of the day, on the clock before the change
+} TzChange;
+
+typedef struct {
+    int16_t offset;             // standard time, minutes east of UTC
+    int16_t save;               // minutes added while daylight saving is on
+    TzChange start, end;
+} TzZone;
+
+enum {
+    TZ_UTC,
+    TZ_US_HAWAII,
+    TZ_US_ALASKA,
+    TZ_US_PACIFIC,
+    TZ_US_ARIZONA,
+    TZ_US_MOUNTAIN,
+    TZ_US_CENTRAL,
+    TZ_US_EASTERN,
+    TZ_US_ATLANTIC,
+    TZ_UK,
+    TZ_CENTRAL_EUROPE,
+    TZ_EASTERN_EUROPE,
+    TZ_INDIA,
+    TZ_CHINA,
+    TZ_JAPAN,
+    TZ_SYDNEY,
+    TZ_AUCKLAND,
+    TZ_ZONES
+};
+
+extern const TzZone tz_zones[TZ_ZONES];
+
+// One zone and the year last converted in it
+typedef struct {
+    const TzZone* zone;
+    int first_jd, next_jd;      // the year: jd of its 1 January and the next
+    int32_t start, end;         // its changes, standard time minutes from first_jd
+} TzYear;
+
+void tz_init(TzYear* y, const TzZone* zone);
+
+// Minutes of daylight saving at a standard time minute of day jd
+int tz_save(TzYear* y, int jd, int minute);
+
+// Standard time hours of day jd on the wall clock, 99.0 (no event) kept;
+// 24 or more is that many hours less on the day after
+float tz_local(TzYear* y, int jd, float hours);
+
+#endif // TZ_H
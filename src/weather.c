@@ -0,0 +1,19 @@
+#include <string.h>
+#include "weather.h"
+
+int weather_decode(const uint8_t* data, int length, Weather* w)
+{
+    int n;
+    if (length < WEATHER_HEADER_SIZE || data[0] != WEATHER_VERSION) return 0;
+    n = data[12];
+    if (n > WEATHER_COND_MAX || WEATHER_HEADER_SIZE + n > length) return 0;
+    w->icon = data[1];
+    w->temp = (int16_t)(data[2] | (data[3] << 8));
+    w->bar = (uint32_t)data[4] | ((uint32_t)data[5] << 8) | ((uint32_t)data[6] << 16) |
+             ((uint32_t)data[7] << 24);
+    w->time = (uint32_t)data[8] | ((uint32_t)data[9] << 8) | ((uint32_t)data[10] << 16) |
+              ((uint32_t)data[11] << 24);
+    memcpy(w->cond, data + WEATHER_HEADER_SIZE, n);
+    w->cond[n] = '\0';
+    return 1;
+}
@@ -0,0 +1,35 @@
+#ifndef WEATHER_H
+#define WEATHER_H
+
+#include <stdint.h>
+
+/*
+ * Weather as the phone sends it: one byte array under WEATHER_KEY,
+ * encoded by encodeWeather() in pebble-js-app.js.
+ *
+ * Layout, all little-endian:
+ *   uint8  version (WEATHER_VERSION)
+ *   uint8  icon index into the atlas
+ *   int16  temperature, whole degrees
+ *   uint32 pressure in 1/100 of the unit the server reports (inHg or
+ *          hPa; 1013.25 hPa does not fit 16 bits)
+ *   uint32 time of the reading, local epoch seconds (0 = never)
+ *   uint8  condition length, then that many bytes of text (no NUL)
+ */
+#define WEATHER_VERSION      2
+#define WEATHER_HEADER_SIZE  13
+#define WEATHER_COND_MAX     31
+#define WEATHER_MAX_SIZE     (WEATHER_HEADER_SIZE + WEATHER_COND_MAX)
+
+typedef struct {
+    int16_t temp;
+    uint32_t bar;               // 1/100 of the server's unit, inHg or hPa
+    uint8_t icon;
+    uint32_t time;              // 0 = never updated
+    char cond[WEATHER_COND_MAX + 1];
+} Weather;
+
+// false if the payload is not a version we understand; w is untouched then
+int weather_decode(const uint8_t* data, int length, Weather* w);
+
+#endif // WEATHER_H